@@ -0,0 +1,168 @@
+#pragma once
+#include "Position.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// Wire format shared by chess-server and its clients. Every frame is
+// [u8 type][u8 payload length][payload], integers little-endian.
+enum MessageType : uint8_t
+{
+    // Client to server
+    MSG_NEW_GAME = 0x01,     // [u8 flags]            GAME_VS_ENGINE gives black to the engine
+    MSG_JOIN_GAME = 0x02,    // [u32 game]            take the free black seat
+    MSG_MOVE = 0x03,         // [u32 game][u8 from][u8 to]
+    MSG_GET_POSITION = 0x04, // [u32 game]
+
+    // Server to client
+    MSG_GAME_STARTED = 0x81, // [u32 game][u8 color]  0 white, 1 black
+    MSG_MOVE_PLAYED = 0x82,  // [u32 game][u8 from][u8 to][u8 status] sent to both sides
+    MSG_POSITION = 0x83,     // [u32 game][u8 white to move][64 x i8 board]
+    MSG_ERROR = 0x84         // [u32 game][u8 code]
+};
+
+const uint8_t GAME_VS_ENGINE = 0x01;
+
+enum GameStatus : uint8_t
+{
+    STATUS_ONGOING,
+    STATUS_WHITE_WINS,
+    STATUS_BLACK_WINS,
+    STATUS_DRAW // The side to move has no moves
+};
+
+enum ErrorCode : uint8_t
+{
+    ERR_BAD_MESSAGE = 1,
+    ERR_UNKNOWN_GAME,
+    ERR_GAME_FULL,
+    ERR_NOT_YOUR_TURN,
+    ERR_ILLEGAL_MOVE,
+    ERR_OPPONENT_LEFT,
+    ERR_NO_OPPONENT // Moves wait until both seats are taken
+};
+
+const size_t FRAME_HEADER_SIZE = 2;
+
+// One decoded frame. Which fields carry data depends on the type, see above.
+struct Message
+{
+    uint8_t type = 0;
+    uint32_t gameId = 0;
+    uint8_t value = 0; // flags, color, status, side to move or error code
+    Move move = {0, 0};
+    int8_t board[64] = {};
+};
+
+inline size_t payloadSize(uint8_t type)
+{
+    switch (type)
+    {
+    case MSG_NEW_GAME:
+        return 1;
+    case MSG_JOIN_GAME:
+    case MSG_GET_POSITION:
+        return 4;
+    case MSG_MOVE:
+        return 6;
+    case MSG_GAME_STARTED:
+    case MSG_ERROR:
+        return 5;
+    case MSG_MOVE_PLAYED:
+        return 7;
+    case MSG_POSITION:
+        return 69;
+    default:
+        return 0;
+    }
+}
+
+inline void putU32(uint8_t *out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = uint8_t(v >> (8 * i));
+}
+
+inline uint32_t getU32(const uint8_t *in)
+{
+    return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+// Appends the encoded frame to out
+inline void encodeMessage(const Message &msg, vector<uint8_t> &out)
+{
+    size_t size = payloadSize(msg.type);
+    size_t start = out.size();
+    out.resize(start + FRAME_HEADER_SIZE + size);
+    uint8_t *p = out.data() + start;
+    p[0] = msg.type;
+    p[1] = uint8_t(size);
+    p += FRAME_HEADER_SIZE;
+
+    if (msg.type == MSG_NEW_GAME)
+    {
+        p[0] = msg.value;
+        return;
+    }
+    putU32(p, msg.gameId);
+    switch (msg.type)
+    {
+    case MSG_MOVE:
+    case MSG_MOVE_PLAYED:
+        p[4] = msg.move.from;
+        p[5] = msg.move.to;
+        if (msg.type == MSG_MOVE_PLAYED)
+            p[6] = msg.value;
+        break;
+    case MSG_GAME_STARTED:
+    case MSG_ERROR:
+        p[4] = msg.value;
+        break;
+    case MSG_POSITION:
+        p[4] = msg.value;
+        memcpy(p + 5, msg.board, 64);
+        break;
+    }
+}
+
+// Decodes one frame from the front of data. Returns the bytes consumed, 0 if
+// the frame is incomplete, or -1 if the stream is corrupt.
+inline long decodeMessage(const uint8_t *data, size_t available, Message &msg)
+{
+    if (available < FRAME_HEADER_SIZE)
+        return 0;
+    size_t size = payloadSize(data[0]);
+    if (size == 0 || data[1] != size)
+        return -1;
+    if (available < FRAME_HEADER_SIZE + size)
+        return 0;
+
+    const uint8_t *p = data + FRAME_HEADER_SIZE;
+    msg.type = data[0];
+    if (msg.type == MSG_NEW_GAME)
+        msg.value = p[0];
+    else
+    {
+        msg.gameId = getU32(p);
+        switch (msg.type)
+        {
+        case MSG_MOVE:
+        case MSG_MOVE_PLAYED:
+            msg.move = Move{p[4], p[5]};
+            if (msg.type == MSG_MOVE_PLAYED)
+                msg.value = p[6];
+            break;
+        case MSG_GAME_STARTED:
+        case MSG_ERROR:
+            msg.value = p[4];
+            break;
+        case MSG_POSITION:
+            msg.value = p[4];
+            memcpy(msg.board, p + 5, 64);
+            break;
+        }
+    }
+    return long(FRAME_HEADER_SIZE + size);
+}
@@ -0,0 +1,570 @@
+#pragma once
+#include "Mcts.hpp"
+#include "Position.hpp"
+#include "Profiler.hpp"
+#include "Protocol.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Connection id standing in for the engine seat
+const uint32_t ENGINE_CONN = 0xFFFFFFFF;
+
+// Unsent bytes a connection may pile up before it counts as not reading
+const size_t MAX_PENDING_OUTPUT = 1 << 20;
+
+// Hosts many games at once. A single epoll thread owns every socket and only
+// parses frames; games are sharded by id across a worker pool, so each game
+// is touched by exactly one worker and needs no locking.
+class Server
+{
+public:
+    // With enginePlayouts > 0 the engine seat searches that many MCTS playouts
+    // per move and samples its reply at the given temperature (0 = strongest)
+    explicit Server(int workerCount, int enginePlayouts = 0, float engineTemperature = 0.f)
+        : enginePlayouts(enginePlayouts), engineTemperature(engineTemperature), workers(max(1, workerCount))
+    {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(wakeFd, EPOLLIN);
+    }
+
+    ~Server()
+    {
+        for (auto &c : connections)
+            close(c.second.fd);
+        for (int fd : listenFds)
+            close(fd);
+        close(wakeFd);
+        close(epollFd);
+    }
+
+    bool listenTcp(uint16_t port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        return finishListen(fd, (sockaddr *)&addr, sizeof(addr));
+    }
+
+    bool listenUnix(const string &path)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        return finishListen(fd, (sockaddr *)&addr, sizeof(addr));
+    }
+
+    // Runs the I/O loop on the calling thread until stop() is called
+    void run()
+    {
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].th = thread([this, i]() { workerLoop(workers[i]); });
+
+        epoll_event events[256];
+        while (!stopping.load())
+        {
+            int n = epoll_wait(epollFd, events, 256, -1);
+            for (int i = 0; i < n; i++)
+            {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd)
+                    flushReplies();
+                else if (isListenFd(fd))
+                    acceptAll(fd);
+                else
+                    serviceConnection(fd, events[i].events);
+            }
+        }
+
+        for (auto &w : workers)
+        {
+            {
+                lock_guard<mutex> lock(w.m);
+                w.quit = true;
+            }
+            w.cv.notify_one();
+        }
+        for (auto &w : workers)
+            w.th.join();
+    }
+
+    // Safe to call from a signal handler
+    void stop()
+    {
+        stopping.store(true);
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+
+    uint64_t gamesStarted() const { return gamesStartedCount.load(); }
+    uint64_t movesPlayed() const { return movesPlayedCount.load(); }
+
+private:
+    struct Connection
+    {
+        int fd;
+        uint32_t id;
+        vector<uint8_t> in, out;
+        bool wantWrite = false;
+    };
+
+    struct Game
+    {
+        Position position;
+        uint32_t white = 0, black = 0; // 0 while the seat is free
+    };
+
+    // Work for one game, or a disconnect notice when msg.type is 0
+    struct Job
+    {
+        uint32_t connId;
+        Message msg;
+    };
+
+    struct Reply
+    {
+        uint32_t connId;
+        Message msg;
+    };
+
+    struct Worker
+    {
+        thread th;
+        mutex m;
+        condition_variable cv;
+        deque<Job> jobs;
+        bool quit = false;
+        unordered_map<uint32_t, Game> games; // Only touched by this worker
+        mt19937 rng{random_device{}()};
+        unique_ptr<Mcts> mcts; // Created on the first engine move
+    };
+
+    int epollFd, wakeFd;
+    int enginePlayouts;
+    float engineTemperature;
+    vector<int> listenFds;
+    unordered_map<int, Connection> connections; // Keyed by fd, I/O thread only
+    unordered_map<uint32_t, int> connectionFds;
+    uint32_t nextConnId = 1;
+    uint32_t nextGameId = 1;
+
+    mutex replyMutex;
+    vector<Reply> replies;
+    atomic<bool> stopping{false};
+    atomic<uint64_t> gamesStartedCount{0}, movesPlayedCount{0};
+    vector<Worker> workers; // Last, so everything the workers read is initialized first
+
+    void watch(int fd, uint32_t events)
+    {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    bool finishListen(int fd, sockaddr *addr, socklen_t length)
+    {
+        if (fd < 0 || bind(fd, addr, length) < 0 || listen(fd, SOMAXCONN) < 0)
+        {
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+        listenFds.push_back(fd);
+        watch(fd, EPOLLIN);
+        return true;
+    }
+
+    bool isListenFd(int fd) const
+    {
+        for (int l : listenFds)
+            if (l == fd)
+                return true;
+        return false;
+    }
+
+    void acceptAll(int listenFd)
+    {
+        while (true)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on Unix sockets
+            Connection &c = connections[fd];
+            c.fd = fd;
+            c.id = nextConnId++;
+            connectionFds[c.id] = fd;
+            watch(fd, EPOLLIN | EPOLLRDHUP);
+        }
+    }
+
+    void serviceConnection(int fd, uint32_t events)
+    {
+        auto it = connections.find(fd);
+        if (it == connections.end())
+            return;
+        Connection &c = it->second;
+
+        if (events & EPOLLOUT)
+            writeSome(c);
+
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        {
+            uint8_t buffer[16384];
+            while (true)
+            {
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n > 0)
+                {
+                    c.in.insert(c.in.end(), buffer, buffer + n);
+                    continue;
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                {
+                    dropConnection(c);
+                    return;
+                }
+                break;
+            }
+            if (!parseFrames(c))
+                dropConnection(c);
+        }
+    }
+
+    bool parseFrames(Connection &c)
+    {
+        size_t offset = 0;
+        while (true)
+        {
+            Message msg;
+            long used = decodeMessage(c.in.data() + offset, c.in.size() - offset, msg);
+            if (used < 0)
+                return false;
+            if (used == 0)
+                break;
+            offset += used;
+
+            if (msg.type == MSG_NEW_GAME)
+                msg.gameId = nextGameId++;
+            else if (msg.type != MSG_JOIN_GAME && msg.type != MSG_MOVE && msg.type != MSG_GET_POSITION)
+                return false;
+            submit(workerFor(msg.gameId), Job{c.id, msg});
+        }
+        c.in.erase(c.in.begin(), c.in.begin() + offset);
+        return true;
+    }
+
+    void dropConnection(Connection &c)
+    {
+        uint32_t id = c.id;
+        int fd = c.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connectionFds.erase(id);
+        connections.erase(fd);
+
+        // Any worker may hold a game with this player
+        for (auto &w : workers)
+            submit(w, Job{id, Message()});
+    }
+
+    Worker &workerFor(uint32_t gameId) { return workers[gameId % workers.size()]; }
+
+    void submit(Worker &w, const Job &job)
+    {
+        {
+            lock_guard<mutex> lock(w.m);
+            w.jobs.push_back(job);
+        }
+        w.cv.notify_one();
+    }
+
+    // Moves replies queued by the workers onto their sockets
+    void flushReplies()
+    {
+        uint64_t count;
+        ssize_t drained = read(wakeFd, &count, sizeof(count));
+        (void)drained;
+
+        vector<Reply> batch;
+        {
+            lock_guard<mutex> lock(replyMutex);
+            batch.swap(replies);
+        }
+
+        vector<int> touched;
+        for (auto &r : batch)
+        {
+            auto fdIt = connectionFds.find(r.connId);
+            if (fdIt == connectionFds.end())
+                continue;
+            Connection &c = connections[fdIt->second];
+            if (c.out.size() >= MAX_PENDING_OUTPUT)
+            {
+                // The client stopped reading, later replies for it are skipped
+                dropConnection(c);
+                continue;
+            }
+            if (c.out.empty())
+                touched.push_back(c.fd);
+            encodeMessage(r.msg, c.out);
+        }
+        for (int fd : touched)
+        {
+            auto it = connections.find(fd);
+            if (it != connections.end())
+                writeSome(it->second);
+        }
+    }
+
+    void writeSome(Connection &c)
+    {
+        size_t offset = 0;
+        while (offset < c.out.size())
+        {
+            ssize_t n = send(c.fd, c.out.data() + offset, c.out.size() - offset, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            offset += n;
+        }
+        c.out.erase(c.out.begin(), c.out.begin() + offset);
+
+        // Only ask for EPOLLOUT while there is a backlog
+        bool wantWrite = !c.out.empty();
+        if (wantWrite != c.wantWrite)
+        {
+            epoll_event ev = {};
+            ev.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? uint32_t(EPOLLOUT) : 0u);
+            ev.data.fd = c.fd;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+            c.wantWrite = wantWrite;
+        }
+    }
+
+    void workerLoop(Worker &w)
+    {
+        deque<Job> jobs;
+        vector<Reply> out;
+        while (true)
+        {
+            {
+                unique_lock<mutex> lock(w.m);
+                w.cv.wait(lock, [&]() { return w.quit || !w.jobs.empty(); });
+                if (w.quit)
+                    return;
+                jobs.swap(w.jobs);
+            }
+
+            for (auto &job : jobs)
+                handleJob(w, job, out);
+            jobs.clear();
+
+            if (!out.empty())
+            {
+                {
+                    lock_guard<mutex> lock(replyMutex);
+                    replies.insert(replies.end(), out.begin(), out.end());
+                }
+                out.clear();
+                uint64_t one = 1;
+                ssize_t written = write(wakeFd, &one, sizeof(one));
+                (void)written;
+            }
+        }
+    }
+
+    static Message makeError(uint32_t gameId, ErrorCode code)
+    {
+        Message msg;
+        msg.type = MSG_ERROR;
+        msg.gameId = gameId;
+        msg.value = code;
+        return msg;
+    }
+
+    static void sendTo(uint32_t connId, const Message &msg, vector<Reply> &out)
+    {
+        if (connId != 0 && connId != ENGINE_CONN)
+            out.push_back(Reply{connId, msg});
+    }
+
+    void handleJob(Worker &w, const Job &job, vector<Reply> &out)
+    {
+        const Message &msg = job.msg;
+
+        if (msg.type == 0)
+        {
+            // Disconnect: end every game the player was in
+            for (auto it = w.games.begin(); it != w.games.end();)
+            {
+                Game &g = it->second;
+                if (g.white == job.connId || g.black == job.connId)
+                {
+                    sendTo(g.white == job.connId ? g.black : g.white, makeError(it->first, ERR_OPPONENT_LEFT), out);
+                    it = w.games.erase(it);
+                }
+                else
+                    ++it;
+            }
+            return;
+        }
+
+        if (msg.type == MSG_NEW_GAME)
+        {
+            Game &g = w.games[msg.gameId];
+            g.white = job.connId;
+            g.black = (msg.value & GAME_VS_ENGINE) ? ENGINE_CONN : 0;
+            gamesStartedCount++;
+
+            Message started;
+            started.type = MSG_GAME_STARTED;
+            started.gameId = msg.gameId;
+            started.value = 0;
+            sendTo(job.connId, started, out);
+            return;
+        }
+
+        auto it = w.games.find(msg.gameId);
+        if (it == w.games.end())
+        {
+            sendTo(job.connId, makeError(msg.gameId, ERR_UNKNOWN_GAME), out);
+            return;
+        }
+        Game &g = it->second;
+
+        if (msg.type == MSG_JOIN_GAME)
+        {
+            if (g.black != 0 || g.white == job.connId)
+            {
+                sendTo(job.connId, makeError(msg.gameId, ERR_GAME_FULL), out);
+                return;
+            }
+            g.black = job.connId;
+            Message started;
+            started.type = MSG_GAME_STARTED;
+            started.gameId = msg.gameId;
+            started.value = 1;
+            sendTo(job.connId, started, out);
+        }
+        else if (msg.type == MSG_GET_POSITION)
+        {
+            Message position;
+            position.type = MSG_POSITION;
+            position.gameId = msg.gameId;
+            position.value = g.position.whiteTurn;
+            memcpy(position.board, g.position.board, 64);
+            sendTo(job.connId, position, out);
+        }
+        else if (msg.type == MSG_MOVE)
+        {
+            if (g.black == 0)
+            {
+                sendTo(job.connId, makeError(msg.gameId, ERR_NO_OPPONENT), out);
+                return;
+            }
+            uint32_t mover = g.position.whiteTurn ? g.white : g.black;
+            if (mover != job.connId)
+            {
+                sendTo(job.connId, makeError(msg.gameId, ERR_NOT_YOUR_TURN), out);
+                return;
+            }
+            if (!g.position.isLegal(msg.move))
+            {
+                sendTo(job.connId, makeError(msg.gameId, ERR_ILLEGAL_MOVE), out);
+                return;
+            }
+
+            bool over = playMove(msg.gameId, g, msg.move, out);
+            if (!over && (g.position.whiteTurn ? g.white : g.black) == ENGINE_CONN)
+            {
+                Move reply;
+                if (engineMove(w, g.position, reply))
+                    over = playMove(msg.gameId, g, reply, out);
+            }
+            if (over)
+                w.games.erase(it);
+        }
+    }
+
+    bool engineMove(Worker &w, const Position &position, Move &reply)
+    {
+        if (enginePlayouts > 0)
+        {
+            if (!w.mcts)
+            {
+                MctsConfig config;
+                config.nodeCapacity = 1 << 16;
+                w.mcts.reset(new Mcts(config));
+            }
+            MctsLimits limits;
+            limits.playouts = enginePlayouts;
+            w.mcts->setPosition(position);
+            w.mcts->search(limits);
+            if (w.mcts->sampleMove(engineTemperature, w.rng, reply))
+                return true;
+        }
+        // Capture-first play, also the fallback when the search has no root move (full pool)
+        PROFILE_SCOPE(ZONE_SEARCH);
+        return pickCaptureMove(position, w.rng, reply);
+    }
+
+    // Applies a validated move and tells both players, returns true if the game ended
+    bool playMove(uint32_t gameId, Game &g, Move move, vector<Reply> &out)
+    {
+        g.position.makeMove(move);
+        movesPlayedCount++;
+
+        bool whiteWins = false;
+        GameStatus status = STATUS_ONGOING;
+        if (g.position.isGameOver(whiteWins))
+            status = whiteWins ? STATUS_WHITE_WINS : STATUS_BLACK_WINS;
+        else
+        {
+            // A side left without moves would stall the game, call it a draw
+            MoveList list;
+            g.position.generateMoves(list);
+            if (list.count == 0)
+                status = STATUS_DRAW;
+        }
+
+        Message played;
+        played.type = MSG_MOVE_PLAYED;
+        played.gameId = gameId;
+        played.move = move;
+        played.value = status;
+        sendTo(g.white, played, out);
+        sendTo(g.black, played, out);
+        return status != STATUS_ONGOING;
+    }
+};
@@ -0,0 +1,238 @@
+#include "Protocol.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Loopback client for chess-server. Every connection plays several games
+// against the engine at once with random moves and times each round trip
+// from sending a move to receiving the engine's answer.
+
+typedef chrono::steady_clock LoadClock;
+
+struct ClientGame
+{
+    Position position;
+    LoadClock::time_point sentAt;
+};
+
+mutex resultsMutex;
+vector<double> latenciesUs;
+atomic<long> gamesFinished{0};
+atomic<long> gamesToStart{0};
+
+int connectTo(const string &unixPath, const string &host, int port)
+{
+    int fd;
+    if (!unixPath.empty())
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendMessage(int fd, const Message &msg)
+{
+    vector<uint8_t> bytes;
+    encodeMessage(msg, bytes);
+    return send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL) == (ssize_t)bytes.size();
+}
+
+bool sendRandomMove(int fd, uint32_t gameId, ClientGame &game, mt19937 &rng)
+{
+    MoveList list;
+    game.position.generateMoves(list);
+    if (list.count == 0)
+        return false;
+    Message msg;
+    msg.type = MSG_MOVE;
+    msg.gameId = gameId;
+    msg.move = list.moves[rng() % list.count];
+    game.sentAt = LoadClock::now();
+    return sendMessage(fd, msg);
+}
+
+void startGame(int fd)
+{
+    Message msg;
+    msg.type = MSG_NEW_GAME;
+    msg.value = GAME_VS_ENGINE;
+    sendMessage(fd, msg);
+}
+
+// Keeps gamesPerConnection games running until the shared quota is used up
+void runConnection(int fd, int gamesPerConnection, unsigned seed)
+{
+    mt19937 rng(seed);
+    unordered_map<uint32_t, ClientGame> games;
+    vector<double> local;
+    vector<uint8_t> in;
+
+    for (int i = 0; i < gamesPerConnection; i++)
+        startGame(fd);
+
+    int active = gamesPerConnection;
+    uint8_t buffer[16384];
+    while (active > 0)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0)
+            break;
+        in.insert(in.end(), buffer, buffer + n);
+
+        size_t offset = 0;
+        Message msg;
+        long used;
+        while ((used = decodeMessage(in.data() + offset, in.size() - offset, msg)) > 0)
+        {
+            offset += used;
+            bool finished = false;
+            if (msg.type == MSG_GAME_STARTED)
+                finished = !sendRandomMove(fd, msg.gameId, games[msg.gameId], rng);
+            else if (msg.type != MSG_MOVE_PLAYED)
+            {
+                cerr << "Server error " << int(msg.value) << " in game " << msg.gameId << "\n";
+                finished = true;
+            }
+            else
+            {
+                ClientGame &game = games[msg.gameId];
+                game.position.makeMove(msg.move);
+                bool engineMoved = game.position.whiteTurn;
+                if (engineMoved)
+                    local.push_back(chrono::duration<double, micro>(LoadClock::now() - game.sentAt).count());
+
+                if (msg.value != STATUS_ONGOING)
+                    finished = true;
+                else if (engineMoved)
+                    finished = !sendRandomMove(fd, msg.gameId, game, rng);
+            }
+
+            if (finished)
+            {
+                games.erase(msg.gameId);
+                gamesFinished++;
+                if (gamesToStart-- > 0)
+                    startGame(fd);
+                else
+                    active--;
+            }
+        }
+        if (used < 0)
+            break;
+        in.erase(in.begin(), in.begin() + offset);
+    }
+
+    close(fd);
+    lock_guard<mutex> lock(resultsMutex);
+    latenciesUs.insert(latenciesUs.end(), local.begin(), local.end());
+}
+
+int main(int argc, char **argv)
+{
+    string host = "127.0.0.1", unixPath;
+    int port = 5555, connections = 4, gamesPerConnection = 50;
+    long totalGames = 1000;
+
+    // The server's worker count, only used to report throughput per worker.
+    // Defaults to chess-server's own default on this machine.
+    int serverWorkers = max(1, (int)thread::hardware_concurrency() - 1);
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc)
+            host = argv[++i];
+        else if (arg == "--port" && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (arg == "--unix" && i + 1 < argc)
+            unixPath = argv[++i];
+        else if (arg == "--connections" && i + 1 < argc)
+            connections = atoi(argv[++i]);
+        else if (arg == "--concurrent" && i + 1 < argc)
+            gamesPerConnection = atoi(argv[++i]);
+        else if (arg == "--games" && i + 1 < argc)
+            totalGames = atol(argv[++i]);
+        else if (arg == "--workers" && i + 1 < argc)
+            serverWorkers = max(1, atoi(argv[++i]));
+        else
+        {
+            cout << "Usage: chess-loadtest [--host H] [--port N | --unix PATH] [--connections N]\n"
+                 << "                      [--concurrent GAMES_PER_CONNECTION] [--games TOTAL]\n"
+                 << "                      [--workers SERVER_WORKERS]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    gamesToStart = totalGames - (long)connections * gamesPerConnection;
+    auto start = LoadClock::now();
+    vector<thread> threads;
+    for (int c = 0; c < connections; c++)
+    {
+        int fd = connectTo(unixPath, host, port);
+        if (fd < 0)
+        {
+            cerr << "Cannot connect to server\n";
+            return 1;
+        }
+        threads.emplace_back(runConnection, fd, gamesPerConnection, 1234u + c);
+    }
+    for (auto &t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(LoadClock::now() - start).count();
+
+    if (latenciesUs.empty())
+    {
+        cerr << "No moves were played\n";
+        return 1;
+    }
+    sort(latenciesUs.begin(), latenciesUs.end());
+    auto percentile = [](double p) { return latenciesUs[size_t(p / 100 * (latenciesUs.size() - 1))]; };
+
+    cout << "Games: " << gamesFinished << " in " << seconds << " s, "
+         << connections * gamesPerConnection << " concurrent\n";
+    cout << "Games/s: " << gamesFinished / seconds << ", " << gamesFinished / seconds / serverWorkers << " per server worker ("
+         << serverWorkers << ")\n";
+    cout << "Move round trips: " << latenciesUs.size() << " (" << latenciesUs.size() / seconds << " /s)\n";
+    cout << "Latency us  p50 " << percentile(50) << "  p95 " << percentile(95) << "  p99 " << percentile(99)
+         << "  max " << latenciesUs.back() << "\n";
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Server.hpp"
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+Server *runningServer = nullptr;
+
+void handleSignal(int)
+{
+    if (runningServer)
+        runningServer->stop();
+}
+
+void printUsage()
+{
+    cout << "Usage: chess-server [--port N] [--unix PATH] [--workers N]\n"
+         << "                    [--engine-playouts N] [--engine-temperature T]\n"
+         << "Hosts games over TCP and/or a Unix domain socket. Defaults to --port 5555.\n"
+         << "The engine plays capture-first moves unless --engine-playouts turns on MCTS;\n"
+         << "a temperature above 0 makes it weaker and more varied.\n";
+}
+
+int main(int argc, char **argv)
+{
+    int port = -1;
+    string unixPath;
+    int workerCount = max(1, (int)thread::hardware_concurrency() - 1);
+    int enginePlayouts = 0;
+    float engineTemperature = 0.f;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (arg == "--unix" && i + 1 < argc)
+            unixPath = argv[++i];
+        else if (arg == "--workers" && i + 1 < argc)
+            workerCount = atoi(argv[++i]);
+        else if (arg == "--engine-playouts" && i + 1 < argc)
+            enginePlayouts = atoi(argv[++i]);
+        else if (arg == "--engine-temperature" && i + 1 < argc)
+            engineTemperature = (float)atof(argv[++i]);
+        else
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (port < 0 && unixPath.empty())
+        port = 5555;
+
+    Server server(workerCount, enginePlayouts, engineTemperature);
+    if (port >= 0 && !server.listenTcp((uint16_t)port))
+    {
+        cerr << "Cannot listen on port " << port << "\n";
+        return 1;
+    }
+    if (!unixPath.empty() && !server.listenUnix(unixPath))
+    {
+        cerr << "Cannot listen on " << unixPath << "\n";
+        return 1;
+    }
+
+    runningServer = &server;
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    cout << "chess-server: " << workerCount << " workers";
+    if (port >= 0)
+        cout << ", tcp port " << port;
+    if (!unixPath.empty())
+        cout << ", unix " << unixPath;
+    cout << endl;
+
+    server.run();
+
+    cout << "Games started: " << server.gamesStarted() << ", moves played: " << server.movesPlayed() << endl;
+    Profiler::dumpTotals(cout);
+    if (!unixPath.empty())
+        unlink(unixPath.c_str());
+    return 0;
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sf;
+using namespace std;
+
+const int PIECE_TEXTURE_COUNT = 12;
+
+// Indexed by PieceID, the icon goes last
+const char *const ASSET_PATHS[PIECE_TEXTURE_COUNT + 1] = {
+    "Assets/White Pieces/Pawn.png", "Assets/White Pieces/Rook.png", "Assets/White Pieces/Knight.png",
+    "Assets/White Pieces/Bishop.png", "Assets/White Pieces/Queen.png", "Assets/White Pieces/King.png",
+    "Assets/Black Pieces/Pawn.png", "Assets/Black Pieces/Rook.png", "Assets/Black Pieces/Knight.png",
+    "Assets/Black Pieces/Bishop.png", "Assets/Black Pieces/Queen.png", "Assets/Black Pieces/King.png",
+    "Assets/icon.png"};
+
+// Decoded pixels of every asset in one file, built by chess-atlas at build
+// time so launches skip PNG decoding. Pixels are run-length encoded: the
+// pieces are mostly transparent, so this is ~95 KB against ~790 KB raw.
+const char *const ATLAS_PATH = "Assets/pieces.atlas";
+const uint32_t ATLAS_MAGIC = 0x53415443; // "CTAS"
+const uint32_t ATLAS_VERSION = 2;
+
+// One run of identical RGBA pixels
+struct AtlasRun
+{
+    uint16_t length;
+    Uint8 rgba[4];
+};
+static_assert(sizeof(AtlasRun) == 6, "AtlasRun is stored as-is in the atlas");
+
+// Layout: magic, version, count, then per image width, height, run count and runs
+inline bool readAtlas(vector<Image> &images)
+{
+    ifstream in(ATLAS_PATH, ios::binary | ios::ate);
+    if (!in)
+        return false;
+    vector<char> blob((size_t)in.tellg());
+    in.seekg(0);
+    if (!in.read(blob.data(), blob.size()))
+        return false;
+
+    size_t offset = 0;
+    auto readU32 = [&](uint32_t &value)
+    {
+        if (offset + 4 > blob.size())
+            return false;
+        memcpy(&value, blob.data() + offset, 4);
+        offset += 4;
+        return true;
+    };
+
+    uint32_t magic, version, count;
+    if (!readU32(magic) || !readU32(version) || !readU32(count) || magic != ATLAS_MAGIC ||
+        version != ATLAS_VERSION || count != images.size())
+        return false;
+
+    vector<Uint8> pixels;
+    for (auto &image : images)
+    {
+        uint32_t width, height, runCount;
+        if (!readU32(width) || !readU32(height) || !readU32(runCount))
+            return false;
+        if (offset + (size_t)runCount * sizeof(AtlasRun) > blob.size())
+            return false;
+        size_t pixelCount = (size_t)width * height;
+        pixels.resize(pixelCount * 4);
+        size_t filled = 0;
+        for (uint32_t r = 0; r < runCount; r++, offset += sizeof(AtlasRun))
+        {
+            AtlasRun run;
+            memcpy(&run, blob.data() + offset, sizeof(AtlasRun));
+            if (filled + run.length > pixelCount)
+                return false;
+            for (uint16_t k = 0; k < run.length; k++, filled++)
+                memcpy(&pixels[filled * 4], run.rgba, 4);
+        }
+        if (filled != pixelCount || pixelCount == 0)
+            return false;
+        image.create(width, height, pixels.data());
+    }
+    return true;
+}
+
+inline bool writeAtlas(const vector<Image> &images)
+{
+    // Written to a temporary name first so a failed build never leaves a torn atlas
+    string tempPath = string(ATLAS_PATH) + ".tmp";
+    {
+        ofstream out(tempPath, ios::binary);
+        if (!out)
+            return false;
+        auto writeU32 = [&](uint32_t value) { out.write(reinterpret_cast<const char *>(&value), 4); };
+        writeU32(ATLAS_MAGIC);
+        writeU32(ATLAS_VERSION);
+        writeU32((uint32_t)images.size());
+        for (auto &image : images)
+        {
+            Vector2u size = image.getSize();
+            const Uint8 *pixels = image.getPixelsPtr();
+            size_t pixelCount = (size_t)size.x * size.y;
+            vector<AtlasRun> runs;
+            for (size_t i = 0; i < pixelCount;)
+            {
+                AtlasRun run;
+                memcpy(run.rgba, pixels + i * 4, 4);
+                size_t j = i + 1;
+                while (j < pixelCount && j - i < UINT16_MAX && memcmp(pixels + j * 4, run.rgba, 4) == 0)
+                    j++;
+                run.length = (uint16_t)(j - i);
+                runs.push_back(run);
+                i = j;
+            }
+            writeU32(size.x);
+            writeU32(size.y);
+            writeU32((uint32_t)runs.size());
+            out.write(reinterpret_cast<const char *>(runs.data()), (streamsize)(runs.size() * sizeof(AtlasRun)));
+        }
+        if (!out)
+            return false;
+    }
+    error_code ec;
+    filesystem::rename(tempPath, ATLAS_PATH, ec);
+    return !ec;
+}
+
+// Decodes the piece images and the icon on a background thread while the
+// menu renders. Textures are uploaded later from the thread that owns the
+// GL context.
+class AssetLoader
+{
+public:
+    AssetLoader() : decoded(false), uploaded(false) {}
+
+    ~AssetLoader()
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void start()
+    {
+        worker = thread([this]() { decodeAll(); });
+    }
+
+    bool isDecoded() const { return decoded.load(memory_order_acquire); }
+
+    // Uploads the textures and sets the window icon once decoding is done.
+    // Returns false while the decoder is still running unless block is set.
+    bool upload(Texture textures[PIECE_TEXTURE_COUNT], Window &window, bool block = false)
+    {
+        if (uploaded)
+            return true;
+        if (!isDecoded() && !block)
+            return false;
+        if (worker.joinable())
+            worker.join();
+
+        for (int i = 0; i < PIECE_TEXTURE_COUNT; i++)
+            textures[i].loadFromImage(images[i]);
+
+        Image &icon = images[PIECE_TEXTURE_COUNT];
+        if (icon.getSize().x > 0)
+            window.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
+
+        images.clear();
+        uploaded = true;
+        return true;
+    }
+
+private:
+    vector<Image> images;
+    atomic<bool> decoded;
+    bool uploaded;
+    thread worker;
+
+    void decodeAll()
+    {
+        images.resize(PIECE_TEXTURE_COUNT + 1);
+        if (readAtlas(images))
+        {
+            decoded.store(true, memory_order_release);
+            return;
+        }
+
+        // No usable atlas, e.g. chess-atlas never ran: decode the PNGs, each
+        // one independently, split across cores
+        atomic<int> nextImage(0);
+        auto decodeSome = [&]()
+        {
+            for (int i = nextImage++; i <= PIECE_TEXTURE_COUNT; i = nextImage++)
+                images[i].loadFromFile(ASSET_PATHS[i]);
+        };
+        unsigned threadCount = min<unsigned>(max(1u, thread::hardware_concurrency()), PIECE_TEXTURE_COUNT + 1);
+        vector<thread> decoders;
+        for (unsigned t = 1; t < threadCount; t++)
+            decoders.emplace_back(decodeSome);
+        decodeSome();
+        for (auto &d : decoders)
+            d.join();
+        decoded.store(true, memory_order_release);
+    }
+};
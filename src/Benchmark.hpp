@@ -0,0 +1,115 @@
+#pragma once
+#include "Profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Summary of a replayed benchmark run. Unlike the profiler history it
+// covers every frame of the run, not just the last ten seconds.
+struct BenchReport
+{
+    uint64_t frames = 0;
+    double p50 = 0, p95 = 0, p99 = 0, worst = 0;
+    double drawCallsPerFrame = 0;
+    double allocationsPerFrame = 0;
+
+    static BenchReport fromFrames(const vector<FrameSample> &samples)
+    {
+        BenchReport report;
+        report.frames = samples.size();
+        if (samples.empty())
+            return report;
+
+        vector<float> times;
+        for (auto &s : samples)
+        {
+            times.push_back(s.frameMs);
+            report.drawCallsPerFrame += s.counters[COUNTER_DRAW_CALLS];
+            report.allocationsPerFrame += s.counters[COUNTER_ALLOCATIONS];
+        }
+        report.drawCallsPerFrame /= samples.size();
+        report.allocationsPerFrame /= samples.size();
+
+        sort(times.begin(), times.end());
+        auto percentile = [&](double p) { return times[size_t(p / 100 * (times.size() - 1) + 0.5)]; };
+        report.p50 = percentile(50);
+        report.p95 = percentile(95);
+        report.p99 = percentile(99);
+        report.worst = times.back();
+        return report;
+    }
+
+    bool save(const string &path) const
+    {
+        ofstream out(path);
+        out << "{\n  \"frames\": " << frames << ",\n";
+        out << "  \"frame_ms\": {\"p50\": " << p50 << ", \"p95\": " << p95 << ", \"p99\": " << p99
+            << ", \"max\": " << worst << "},\n";
+        out << "  \"draw_calls_per_frame\": " << drawCallsPerFrame << ",\n";
+        out << "  \"allocations_per_frame\": " << allocationsPerFrame << "\n}\n";
+        return bool(out);
+    }
+
+    // Reads back a file written by save(). The keys have to come in save()'s
+    // order with nothing else in between, anything else fails.
+    bool load(const string &path)
+    {
+        ifstream in(path);
+        if (!in)
+            return false;
+        // A space in the expected text stands for optional whitespace
+        auto expect = [&](const char *text)
+        {
+            for (; *text; text++)
+            {
+                if (*text == ' ')
+                    in >> ws;
+                else if (in.get() != *text)
+                    return false;
+            }
+            return true;
+        };
+        bool ok = expect(" { \"frames\": ") && in >> frames;
+        ok = ok && expect(" , \"frame_ms\": { \"p50\": ") && in >> p50;
+        ok = ok && expect(" , \"p95\": ") && in >> p95;
+        ok = ok && expect(" , \"p99\": ") && in >> p99;
+        ok = ok && expect(" , \"max\": ") && in >> worst;
+        ok = ok && expect(" } , \"draw_calls_per_frame\": ") && in >> drawCallsPerFrame;
+        ok = ok && expect(" , \"allocations_per_frame\": ") && in >> allocationsPerFrame;
+        ok = ok && expect(" } ");
+        return ok && in.peek() == EOF;
+    }
+
+    void print(ostream &out) const
+    {
+        out << frames << " frames, frame ms p50 " << p50 << "  p95 " << p95 << "  p99 " << p99 << "  max " << worst
+            << "\ndraw calls/frame " << drawCallsPerFrame << ", allocations/frame " << allocationsPerFrame << "\n";
+    }
+
+    // Prints each metric next to the baseline. Returns false when p95 frame
+    // time, draw calls or allocations grew by more than tolerance (a
+    // fraction). p99 and max are shown but too noisy to fail a build on.
+    bool compare(const BenchReport &baseline, double tolerance, ostream &out) const
+    {
+        bool ok = true;
+        auto row = [&](const char *name, double now, double before, bool gate)
+        {
+            double change = before > 0 ? (now - before) / before : (now > 0 ? 1 : 0);
+            bool regressed = gate && change > tolerance;
+            ok = ok && !regressed;
+            out << "  " << name << "  " << before << " -> " << now << "  (" << (change >= 0 ? "+" : "")
+                << change * 100 << "%)" << (regressed ? "  REGRESSED" : "") << "\n";
+        };
+        row("frame ms p50", p50, baseline.p50, false);
+        row("frame ms p95", p95, baseline.p95, true);
+        row("frame ms p99", p99, baseline.p99, false);
+        row("frame ms max", worst, baseline.worst, false);
+        row("draw calls/frame", drawCallsPerFrame, baseline.drawCallsPerFrame, true);
+        row("allocations/frame", allocationsPerFrame, baseline.allocationsPerFrame, true);
+        return ok;
+    }
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "EvalParams.hpp"
+#include "Position.hpp"
+
+using namespace std;
+
+// Static evaluation: material plus a piece-square bonus, with the tables in
+// EvalParams.hpp written by chess-tune. Black reads the white tables with
+// the board flipped vertically.
+inline int evalSquare(bool white, int square) { return white ? square : square ^ 56; }
+
+// Centipawns from white's point of view
+inline int evaluate(const Position &position)
+{
+    int score = position.whiteTurn ? EVAL_TEMPO : -EVAL_TEMPO;
+    for (int p = W_P; p <= B_K; p++)
+    {
+        bool white = isWhitePiece(int8_t(p));
+        PieceType type = typeOf(int8_t(p));
+        Bitboard b = position.pieces[p];
+        while (b)
+        {
+            int value = EVAL_PIECE_VALUE[type] + EVAL_PIECE_SQUARE[type][evalSquare(white, popLowest(b))];
+            score += white ? value : -value;
+        }
+    }
+    return score;
+}
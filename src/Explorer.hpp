@@ -0,0 +1,199 @@
+#pragma once
+#include "MappedFile.hpp"
+#include "Position.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum GameResult : uint8_t
+{
+    RESULT_WHITE_WINS,
+    RESULT_DRAW,
+    RESULT_BLACK_WINS
+};
+
+// Game archive: one finished game per line, the result followed by the
+// moves in coordinate notation, e.g. "1-0 e2e4 e7e5 d1h5 ..."
+inline bool appendGame(const string &path, const vector<Move> &moves, GameResult result)
+{
+    ofstream out(path, ios::app);
+    if (!out)
+        return false;
+    const char *results[] = {"1-0", "1/2-1/2", "0-1"};
+    out << results[result];
+    for (Move m : moves)
+        out << " " << moveToString(m);
+    out << "\n";
+    return bool(out);
+}
+
+inline bool parseGame(const string &line, vector<Move> &moves, GameResult &result)
+{
+    istringstream in(line);
+    string token;
+    if (!(in >> token))
+        return false;
+    if (token == "1-0")
+        result = RESULT_WHITE_WINS;
+    else if (token == "0-1")
+        result = RESULT_BLACK_WINS;
+    else if (token == "1/2-1/2")
+        result = RESULT_DRAW;
+    else
+        return false;
+
+    moves.clear();
+    Move m;
+    while (in >> token)
+    {
+        if (!parseMove(token, m))
+            return false;
+        moves.push_back(m);
+    }
+    return true;
+}
+
+// How often one move was played from one position, and how it scored
+struct ExplorerEntry
+{
+    uint64_t key;
+    uint32_t whiteWins, draws, blackWins;
+    uint8_t from, to;
+    uint8_t pad[2];
+
+    uint32_t games() const { return whiteWins + draws + blackWins; }
+};
+
+struct ExplorerHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entryCount;
+    uint64_t fenceCount;
+    uint32_t fenceStride;
+    uint32_t pad;
+};
+
+const uint32_t EXPLORER_MAGIC = 0x58455043; // "CPEX"
+const uint32_t EXPLORER_VERSION = 1;
+
+// Every fenceStride-th key is repeated in a small table at the end of the
+// file. A lookup first searches that table, which stays in the page cache,
+// then only one stride of entries (a few pages) of the big array.
+const uint32_t EXPLORER_FENCE_STRIDE = 512;
+
+// Writes an index from entries that arrive sorted by (key, from, to)
+class ExplorerWriter
+{
+public:
+    ~ExplorerWriter()
+    {
+        if (file)
+            fclose(file);
+    }
+
+    bool open(const string &path)
+    {
+        file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        ExplorerHeader header = {};
+        return fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    void add(const ExplorerEntry &entry)
+    {
+        if (count % EXPLORER_FENCE_STRIDE == 0)
+            fences.push_back(entry.key);
+        ok = ok && fwrite(&entry, sizeof(entry), 1, file) == 1;
+        count++;
+    }
+
+    uint64_t entryCount() const { return count; }
+
+    bool close()
+    {
+        ok = ok && fwrite(fences.data(), sizeof(uint64_t), fences.size(), file) == fences.size();
+
+        ExplorerHeader header = {};
+        header.magic = EXPLORER_MAGIC;
+        header.version = EXPLORER_VERSION;
+        header.entryCount = count;
+        header.fenceCount = fences.size();
+        header.fenceStride = EXPLORER_FENCE_STRIDE;
+        ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+private:
+    FILE *file = nullptr;
+    uint64_t count = 0;
+    vector<uint64_t> fences;
+    bool ok = true;
+};
+
+// Memory-mapped view of an index written by chess-index
+class ExplorerIndex
+{
+public:
+    bool open(const string &path)
+    {
+        if (!mapped.open(path) || mapped.size() < sizeof(ExplorerHeader))
+            return false;
+        const ExplorerHeader *header = reinterpret_cast<const ExplorerHeader *>(mapped.data());
+        size_t expected = sizeof(ExplorerHeader) + header->entryCount * sizeof(ExplorerEntry) +
+                          header->fenceCount * sizeof(uint64_t);
+        if (header->magic != EXPLORER_MAGIC || header->version != EXPLORER_VERSION || mapped.size() != expected ||
+            header->fenceStride == 0)
+        {
+            mapped.close();
+            return false;
+        }
+        entries = reinterpret_cast<const ExplorerEntry *>(mapped.data() + sizeof(ExplorerHeader));
+        count = header->entryCount;
+        fences = reinterpret_cast<const uint64_t *>(entries + count);
+        fenceCount = header->fenceCount;
+        stride = header->fenceStride;
+        return true;
+    }
+
+    bool isOpen() const { return mapped.isOpen(); }
+    uint64_t size() const { return count; }
+
+    // All moves recorded from the position, most played first
+    vector<ExplorerEntry> lookup(uint64_t key) const
+    {
+        vector<ExplorerEntry> result;
+        if (!isOpen())
+            return result;
+
+        // The first entry with this key sits in the stride before the first fence >= key
+        uint64_t fence = lower_bound(fences, fences + fenceCount, key) - fences;
+        uint64_t lo = fence == 0 ? 0 : (fence - 1) * stride;
+        uint64_t hi = min<uint64_t>(count, fence * stride);
+        const ExplorerEntry *it = lower_bound(entries + lo, entries + hi, key,
+                                              [](const ExplorerEntry &e, uint64_t k) { return e.key < k; });
+
+        for (; it != entries + count && it->key == key; ++it)
+            result.push_back(*it);
+        sort(result.begin(), result.end(),
+             [](const ExplorerEntry &a, const ExplorerEntry &b) { return a.games() > b.games(); });
+        return result;
+    }
+
+private:
+    MappedFile mapped;
+    const ExplorerEntry *entries = nullptr;
+    const uint64_t *fences = nullptr;
+    uint64_t count = 0, fenceCount = 0;
+    uint32_t stride = 1;
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Sorts more fixed-size records than fit in memory. Records are buffered up
+// to a byte budget, each full buffer is sorted and spilled to a temporary
+// run file, and finish() merges all runs with a k-way heap merge.
+template <class Record, class Less = less<Record>>
+class ExternalSorter
+{
+public:
+    ExternalSorter(size_t memoryBytes, const string &tempDir = "", Less compare = Less())
+        : compare(compare), capacity(max<size_t>(1024, memoryBytes / sizeof(Record)))
+    {
+        directory = tempDir.empty() ? filesystem::temp_directory_path().string() : tempDir;
+        tag = to_string(random_device{}());
+        buffer.reserve(capacity);
+    }
+
+    ~ExternalSorter()
+    {
+        for (auto &path : runs)
+            remove(path.c_str());
+    }
+
+    void add(const Record &record)
+    {
+        buffer.push_back(record);
+        if (buffer.size() == capacity)
+            spill();
+    }
+
+    size_t runCount() const { return runs.size(); }
+
+    // Calls visit(record) for every record in sorted order. Returns false if
+    // a run file could not be written or read back.
+    template <class Visit>
+    bool finish(Visit visit)
+    {
+        if (runs.empty())
+        {
+            sort(buffer.begin(), buffer.end(), compare);
+            for (auto &r : buffer)
+                visit(r);
+            buffer.clear();
+            return ok;
+        }
+        if (!buffer.empty())
+            spill();
+        if (!ok)
+            return false;
+        buffer.clear();
+        buffer.shrink_to_fit();
+
+        // Split the budget between one read buffer per run
+        size_t perRun = max<size_t>(256, capacity / runs.size());
+        vector<RunReader> readers(runs.size());
+        for (size_t i = 0; i < runs.size(); i++)
+            if (!readers[i].open(runs[i], perRun))
+                return false;
+
+        auto greater = [&](size_t a, size_t b) { return compare(readers[b].current(), readers[a].current()); };
+        priority_queue<size_t, vector<size_t>, decltype(greater)> heap(greater);
+        for (size_t i = 0; i < readers.size(); i++)
+            if (readers[i].next())
+                heap.push(i);
+
+        while (!heap.empty())
+        {
+            size_t i = heap.top();
+            heap.pop();
+            visit(readers[i].current());
+            if (readers[i].next())
+                heap.push(i);
+        }
+        return true;
+    }
+
+private:
+    struct RunReader
+    {
+        FILE *file = nullptr;
+        vector<Record> chunk;
+        size_t pos = 0, size = 0;
+        bool started = false;
+
+        ~RunReader()
+        {
+            if (file)
+                fclose(file);
+        }
+
+        bool open(const string &path, size_t records)
+        {
+            file = fopen(path.c_str(), "rb");
+            chunk.resize(records);
+            return file != nullptr;
+        }
+
+        const Record &current() const { return chunk[pos]; }
+
+        bool next()
+        {
+            if (started && ++pos < size)
+                return true;
+            started = true;
+            size = fread(chunk.data(), sizeof(Record), chunk.size(), file);
+            pos = 0;
+            return size > 0;
+        }
+    };
+
+    Less compare;
+    size_t capacity;
+    string directory, tag;
+    vector<Record> buffer;
+    vector<string> runs;
+    bool ok = true;
+
+    void spill()
+    {
+        sort(buffer.begin(), buffer.end(), compare);
+        string path = (filesystem::path(directory) / ("chess-sort-" + tag + "-" + to_string(runs.size()) + ".run")).string();
+        FILE *file = fopen(path.c_str(), "wb");
+        if (!file || fwrite(buffer.data(), sizeof(Record), buffer.size(), file) != buffer.size())
+            ok = false;
+        if (file)
+            fclose(file);
+        runs.push_back(path);
+        buffer.clear();
+    }
+};
@@ -0,0 +1,167 @@
+#pragma once
+#include <SFML/Window.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace sf;
+using namespace std;
+
+// Input recordings: one line per input event, tagged with the frame it
+// arrived in. Pointer moves are kept as events too, since the main loop
+// does per-event work (hover updates, text refreshes) for each of them.
+// Releases, wheel and focus events are dropped.
+//
+//   <frame> mouse <x> <y>    pointer moved, the position holds from here on
+//   <frame> press <x> <y>    left button press at the position
+//   <frame> key <code>       sf::Keyboard::Key pressed
+//   <frame> text <unicode>   character typed
+//   <frame> close            window closed
+//
+// Lines starting with '#' are comments.
+struct RecordedInput
+{
+    uint64_t frame;
+    Event event;
+    Vector2i mouse;
+};
+
+class InputRecorder
+{
+public:
+    bool open(const string &path)
+    {
+        out.open(path);
+        out << "# Chess input recording\n";
+        return bool(out);
+    }
+
+    bool isOpen() const { return out.is_open(); }
+
+    // Called once per frame before the events are handled
+    void beginFrame(uint64_t frame, Vector2i mouse)
+    {
+        current = frame;
+        lastMouse = mouse;
+    }
+
+    // Clicks are stored at the position the loop read this frame, which is
+    // what it acted on
+    void record(const Event &event)
+    {
+        if (event.type == Event::MouseMoved)
+            out << current << " mouse " << event.mouseMove.x << " " << event.mouseMove.y << "\n";
+        else if (event.type == Event::MouseButtonPressed && event.mouseButton.button == Mouse::Left)
+            out << current << " press " << lastMouse.x << " " << lastMouse.y << "\n";
+        else if (event.type == Event::KeyPressed)
+            out << current << " key " << int(event.key.code) << "\n";
+        else if (event.type == Event::TextEntered)
+            out << current << " text " << event.text.unicode << "\n";
+        else if (event.type == Event::Closed)
+            out << current << " close\n";
+    }
+
+private:
+    ofstream out;
+    uint64_t current = 0;
+    Vector2i lastMouse = Vector2i(-1, -1);
+};
+
+// Feeds a recording back one frame at a time, standing in for pollEvent
+// and Mouse::getPosition
+class InputReplay
+{
+public:
+    bool load(const string &path)
+    {
+        ifstream in(path);
+        if (!in)
+            return false;
+        string line;
+        while (getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            istringstream fields(line);
+            RecordedInput input = {};
+            string kind;
+            if (!(fields >> input.frame >> kind))
+                return false;
+            if (kind == "mouse" || kind == "press")
+            {
+                if (!(fields >> input.mouse.x >> input.mouse.y))
+                    return false;
+                if (kind == "press")
+                {
+                    input.event.type = Event::MouseButtonPressed;
+                    input.event.mouseButton.button = Mouse::Left;
+                    input.event.mouseButton.x = input.mouse.x;
+                    input.event.mouseButton.y = input.mouse.y;
+                }
+                else
+                {
+                    input.event.type = Event::MouseMoved;
+                    input.event.mouseMove.x = input.mouse.x;
+                    input.event.mouseMove.y = input.mouse.y;
+                }
+            }
+            else if (kind == "key")
+            {
+                int code;
+                if (!(fields >> code))
+                    return false;
+                input.event.type = Event::KeyPressed;
+                input.event.key.code = Keyboard::Key(code);
+            }
+            else if (kind == "text")
+            {
+                if (!(fields >> input.event.text.unicode))
+                    return false;
+                input.event.type = Event::TextEntered;
+            }
+            else if (kind == "close")
+                input.event.type = Event::Closed;
+            else
+                return false;
+            inputs.push_back(input);
+        }
+        stable_sort(inputs.begin(), inputs.end(),
+                    [](const RecordedInput &a, const RecordedInput &b) { return a.frame < b.frame; });
+        return !inputs.empty();
+    }
+
+    // Moves to the next frame and applies its pointer moves up front, the
+    // way a real frame polls the pointer where it ended up before its
+    // events are handled
+    void beginFrame()
+    {
+        frame = started ? frame + 1 : 0;
+        started = true;
+        for (size_t i = next; i < inputs.size() && inputs[i].frame == frame; i++)
+            if (inputs[i].event.type == Event::MouseMoved || inputs[i].event.type == Event::MouseButtonPressed)
+                pointer = inputs[i].mouse;
+    }
+
+    // The next input event of the current frame
+    bool pollEvent(Event &event)
+    {
+        if (next >= inputs.size() || inputs[next].frame > frame)
+            return false;
+        event = inputs[next++].event;
+        return true;
+    }
+
+    Vector2i mouse() const { return pointer; }
+    bool finished() const { return next >= inputs.size(); }
+    uint64_t lastFrame() const { return inputs.empty() ? 0 : inputs.back().frame; }
+
+private:
+    vector<RecordedInput> inputs;
+    size_t next = 0;
+    uint64_t frame = 0;
+    bool started = false;
+    Vector2i pointer;
+};
@@ -0,0 +1,244 @@
+#pragma once
+#include "Position.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Proof and disproof numbers at or above this count as infinite
+const uint32_t PN_INFINITY = 100000000;
+
+enum MateVerdict
+{
+    MATE_FOUND,
+    NO_MATE,      // Proven that no mate exists within the move limit
+    MATE_UNKNOWN  // Node budget ran out
+};
+
+struct MateResult
+{
+    MateVerdict verdict = MATE_UNKNOWN;
+    int mateIn = 0; // Moves of the attacking side
+    Move firstMove = {0, 0};
+    uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+// Direct-mapped transposition table of (phi, delta) pairs. Every node is
+// keyed by its position, remaining plies and attacking side. A key therefore
+// means the same thing in every search, and entries stay valid across the
+// iterative deepening steps and across puzzles.
+class MateTable
+{
+public:
+    explicit MateTable(size_t megabytes)
+    {
+        size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= (megabytes << 20))
+            count *= 2;
+        entries.resize(count);
+        mask = count - 1;
+    }
+
+    bool lookup(uint64_t key, uint32_t &phi, uint32_t &delta) const
+    {
+        const Entry &e = entries[key & mask];
+        if (e.key != key)
+            return false;
+        phi = e.phi;
+        delta = e.delta;
+        return true;
+    }
+
+    void store(uint64_t key, uint32_t phi, uint32_t delta) { entries[key & mask] = Entry{key, phi, delta}; }
+
+private:
+    struct Entry
+    {
+        uint64_t key = 0;
+        uint32_t phi = 0, delta = 0;
+    };
+
+    vector<Entry> entries;
+    size_t mask;
+};
+
+// Mate-in-N solver using depth-first proof-number search (df-pn). The side
+// to move at the root attacks. Moves follow standard chess legality (kings
+// may not be left in check) on top of the project's rules, so there is no
+// castling, en passant or promotion. One solver per thread; the table is
+// not shared.
+class MateSolver
+{
+public:
+    explicit MateSolver(size_t tableMegabytes = 64) : table(tableMegabytes) {}
+
+    // Finds the shortest mate of at most maxMoves attacker moves
+    MateResult solve(const Position &position, int maxMoves, uint64_t maxNodes)
+    {
+        PROFILE_SCOPE(ZONE_SEARCH);
+        auto start = chrono::steady_clock::now();
+        MateResult result;
+        attackerWhite = position.whiteTurn;
+        nodes = 0;
+        nodeLimit = maxNodes;
+
+        result.verdict = NO_MATE;
+        for (int moves = 1; moves <= maxMoves; moves++)
+        {
+            int plies = 2 * moves - 1;
+            mid(position, plies, PN_INFINITY, PN_INFINITY);
+
+            // The root entry can be overwritten by a colliding node, read that as unknown
+            uint32_t phi = 1, delta = 1;
+            table.lookup(nodeKey(position, plies), phi, delta);
+            if (delta >= PN_INFINITY)
+            {
+                result.verdict = MATE_FOUND;
+                result.mateIn = moves;
+                result.firstMove = provenMove(position, plies);
+                break;
+            }
+            if (phi < PN_INFINITY)
+            {
+                result.verdict = MATE_UNKNOWN;
+                break;
+            }
+        }
+
+        result.nodes = nodes;
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        PROFILE_COUNT(COUNTER_SEARCH_NODES, nodes);
+        return result;
+    }
+
+private:
+    MateTable table;
+    bool attackerWhite = true;
+    uint64_t nodes = 0, nodeLimit = 0;
+
+    uint64_t nodeKey(const Position &position, int plies) const
+    {
+        uint64_t seed = uint64_t(plies) * 0x5851F42D4C957F2DULL + attackerWhite;
+        return position.key ^ splitMix(seed);
+    }
+
+    // (phi, delta) of a node the search has not reached yet
+    uint32_t lookupPhi(uint64_t key, uint32_t &delta) const
+    {
+        uint32_t phi;
+        if (!table.lookup(key, phi, delta))
+        {
+            phi = 1;
+            delta = 1;
+        }
+        return phi;
+    }
+
+    // phi is the proof number at attacker nodes and the disproof number at
+    // defender nodes, delta the other one. phi == 0 means the side to move
+    // at the node gets what it wants.
+    void mid(const Position &position, int plies, uint32_t thPhi, uint32_t thDelta)
+    {
+        nodes++;
+        bool attacker = position.whiteTurn == attackerWhite;
+        uint64_t key = nodeKey(position, plies);
+
+        MoveList moves;
+        position.generateLegalMoves(moves);
+
+        // The last attacker move has to give check to mate
+        if (attacker && plies == 1)
+        {
+            int kept = 0;
+            for (Move m : moves)
+            {
+                Position child = position;
+                child.makeMove(m);
+                if (child.inCheck(child.whiteTurn))
+                    moves.moves[kept++] = m;
+            }
+            moves.count = kept;
+        }
+
+        if (moves.count == 0)
+        {
+            // Defender mated: proven. Defender stalemated: refuted. Attacker out of moves: refuted.
+            bool mated = !attacker && position.inCheck(position.whiteTurn);
+            if (attacker || mated)
+                table.store(key, PN_INFINITY, 0);
+            else
+                table.store(key, 0, PN_INFINITY);
+            return;
+        }
+        if (plies == 0)
+        {
+            // Defender to move, not mated and out of time
+            table.store(key, 0, PN_INFINITY);
+            return;
+        }
+
+        vector<Position> children(moves.count, position);
+        vector<uint64_t> childKeys(moves.count);
+        for (int i = 0; i < moves.count; i++)
+        {
+            children[i].makeMove(moves.moves[i]);
+            childKeys[i] = nodeKey(children[i], plies - 1);
+        }
+
+        while (true)
+        {
+            // phi(n) = min delta(child), delta(n) = sum phi(child)
+            uint32_t phi = PN_INFINITY;
+            uint64_t delta = 0;
+            int best = 0;
+            uint32_t bestDelta = PN_INFINITY, secondDelta = PN_INFINITY, bestPhi = 0;
+            for (int i = 0; i < moves.count; i++)
+            {
+                uint32_t childDelta;
+                uint32_t childPhi = lookupPhi(childKeys[i], childDelta);
+                delta += childPhi;
+                if (childDelta < bestDelta)
+                {
+                    secondDelta = bestDelta;
+                    bestDelta = childDelta;
+                    bestPhi = childPhi;
+                    best = i;
+                }
+                else if (childDelta < secondDelta)
+                    secondDelta = childDelta;
+            }
+            phi = bestDelta;
+            uint32_t cappedDelta = uint32_t(min<uint64_t>(delta, PN_INFINITY));
+
+            if (phi >= thPhi || cappedDelta >= thDelta || nodes >= nodeLimit)
+            {
+                table.store(key, phi, cappedDelta);
+                return;
+            }
+
+            uint64_t childThPhi = uint64_t(thDelta) + bestPhi - cappedDelta;
+            uint32_t childThDelta = min<uint32_t>(thPhi, secondDelta == PN_INFINITY ? PN_INFINITY : secondDelta + 1);
+            mid(children[best], plies - 1, uint32_t(min<uint64_t>(childThPhi, PN_INFINITY)), childThDelta);
+        }
+    }
+
+    // A root move whose defender node is proven lost
+    Move provenMove(const Position &position, int plies) const
+    {
+        MoveList moves;
+        position.generateLegalMoves(moves);
+        for (Move m : moves)
+        {
+            Position child = position;
+            child.makeMove(m);
+            uint32_t phi, delta;
+            if (table.lookup(nodeKey(child, plies - 1), phi, delta) && delta == 0)
+                return m;
+        }
+        return Move{0, 0};
+    }
+};
@@ -0,0 +1,440 @@
+#pragma once
+#include "Position.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Rewards are summed as fixed point so they can be added atomically
+const uint64_t MCTS_VALUE_ONE = 1 << 16;
+
+// Smallest pool that holds the root and its expansion
+const size_t MCTS_MIN_NODES = 1 + MAX_MOVES;
+
+enum MctsPlayout
+{
+    PLAYOUT_RANDOM,  // Uniform random moves
+    PLAYOUT_CAPTURES // pickCaptureMove: always take a king, the best capture half the time
+};
+
+struct MctsConfig
+{
+    bool puct = true;             // PUCT with capture priors, otherwise plain UCT
+    float exploration = 1.4f;     // c in the UCT / PUCT formula
+    MctsPlayout playout = PLAYOUT_CAPTURES;
+    int maxPlayoutPlies = 200;    // Longer playouts are scored as draws
+    size_t nodeCapacity = 1 << 21; // Nodes per pool (24 bytes each), two pools are allocated
+};
+
+struct MctsLimits
+{
+    int threads = 1;
+    uint64_t playouts = 0; // 0 for no limit
+    int milliseconds = 0;  // 0 for no limit
+};
+
+struct MctsStats
+{
+    uint64_t playouts = 0;
+    double seconds = 0;
+    double playoutsPerSecond = 0;
+    size_t nodes = 0;
+    size_t treeBytes = 0; // Used part of the live pool
+    size_t poolBytes = 0; // Both pools as allocated
+};
+
+struct MctsChild
+{
+    Move move;
+    uint32_t visits;
+    float score; // Average reward for the side to move at the root
+};
+
+// Monte Carlo tree search over Position. Any number of threads descend the
+// tree at once without locks: a visit is counted on the way down (virtual
+// loss) so other threads spread out, and the reward is added on the way
+// back. Nodes come from a preallocated pool and a node's children are one
+// contiguous block, so expansion is a single atomic bump.
+class Mcts
+{
+public:
+    explicit Mcts(const MctsConfig &config = MctsConfig()) : config(config)
+    {
+        // A smaller pool could not even hold the root's children
+        this->config.nodeCapacity = max(config.nodeCapacity, MCTS_MIN_NODES);
+        pool.reset(new Node[this->config.nodeCapacity]);
+        spare.reset(new Node[this->config.nodeCapacity]);
+        reset(Position());
+    }
+
+    const Position &position() const { return rootPosition; }
+
+    // Starts a new tree, or keeps the part of the current one that already
+    // covers the position when it is the root or one or two plies below it.
+    void setPosition(const Position &target)
+    {
+        if (target.key == rootPosition.key)
+            return;
+        for (uint32_t c = 0; c < childCount(root); c++)
+        {
+            Position child = rootPosition;
+            child.makeMove(pool[firstChild(root) + c].move);
+            if (child.key == target.key)
+            {
+                advance(pool[firstChild(root) + c].move);
+                return;
+            }
+            uint32_t node = firstChild(root) + c;
+            for (uint32_t g = 0; g < childCount(node); g++)
+            {
+                Position grandchild = child;
+                grandchild.makeMove(pool[firstChild(node) + g].move);
+                if (grandchild.key == target.key)
+                {
+                    advance(pool[firstChild(root) + c].move);
+                    advance(pool[firstChild(node) + g].move);
+                    return;
+                }
+            }
+        }
+        reset(target);
+    }
+
+    // Moves the root to the child reached by a played move, keeping its subtree
+    void advance(Move played)
+    {
+        Position next = rootPosition;
+        next.makeMove(played);
+        for (uint32_t c = 0; c < childCount(root); c++)
+            if (pool[firstChild(root) + c].move == played)
+            {
+                root = firstChild(root) + c;
+                rootPosition = next;
+                return;
+            }
+        reset(next);
+    }
+
+    MctsStats search(const MctsLimits &limits)
+    {
+        PROFILE_SCOPE(ZONE_SEARCH);
+        auto start = chrono::steady_clock::now();
+
+        // Reclaim the pool space of everything above the root
+        if (root != 0)
+            compact();
+
+        // Nodes normally expand on their second visit. Expand the root up
+        // front so even a one-playout search has root moves to choose from.
+        bool whiteWins;
+        if (pool[root].state.load(memory_order_relaxed) == UNEXPANDED && !rootPosition.isGameOver(whiteWins))
+        {
+            pool[root].state.store(EXPANDING, memory_order_relaxed);
+            expand(root, rootPosition);
+        }
+
+        atomic<uint64_t> playouts(0);
+        atomic<bool> stop(false);
+        auto worker = [&](unsigned seed)
+        {
+            mt19937 rng(seed);
+            uint64_t done;
+            while (!stop.load(memory_order_relaxed))
+            {
+                iterate(rng);
+                done = ++playouts;
+                if (limits.playouts && done >= limits.playouts)
+                    stop = true;
+                if (limits.milliseconds && (done & 63) == 0 &&
+                    chrono::steady_clock::now() - start >= chrono::milliseconds(limits.milliseconds))
+                    stop = true;
+            }
+        };
+
+        if (!limits.playouts && !limits.milliseconds)
+            stop = true;
+        vector<thread> helpers;
+        for (int t = 1; t < limits.threads; t++)
+            helpers.emplace_back(worker, seedSource() + t);
+        worker(seedSource());
+        for (auto &h : helpers)
+            h.join();
+
+        MctsStats stats;
+        stats.playouts = playouts;
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        stats.playoutsPerSecond = stats.seconds > 0 ? stats.playouts / stats.seconds : 0;
+        stats.nodes = min(used.load(), config.nodeCapacity);
+        stats.treeBytes = stats.nodes * sizeof(Node);
+        stats.poolBytes = 2 * config.nodeCapacity * sizeof(Node);
+        PROFILE_COUNT(COUNTER_SEARCH_NODES, stats.playouts);
+        return stats;
+    }
+
+    // Root moves with their statistics, most visited first
+    vector<MctsChild> rootChildren() const
+    {
+        vector<MctsChild> children;
+        for (uint32_t c = 0; c < childCount(root); c++)
+        {
+            const Node &n = pool[firstChild(root) + c];
+            uint32_t visits = n.visits.load();
+            float score = visits ? float(n.valueSum.load()) / MCTS_VALUE_ONE / visits : 0.f;
+            children.push_back(MctsChild{n.move, visits, score});
+        }
+        sort(children.begin(), children.end(), [](const MctsChild &a, const MctsChild &b) { return a.visits > b.visits; });
+        return children;
+    }
+
+    // Most visited root move, false if the root has no moves or was never searched
+    bool bestMove(Move &best) const
+    {
+        vector<MctsChild> children = rootChildren();
+        if (children.empty())
+            return false;
+        best = children[0].move;
+        return true;
+    }
+
+    // Picks a root move with probability proportional to visits^(1/temperature).
+    // Higher temperatures give weaker, more varied play.
+    bool sampleMove(float temperature, mt19937 &rng, Move &chosen) const
+    {
+        vector<MctsChild> children = rootChildren();
+        if (children.empty())
+            return false;
+        if (temperature <= 0.f)
+        {
+            chosen = children[0].move;
+            return true;
+        }
+        vector<double> weights;
+        for (auto &c : children)
+            weights.push_back(pow((double)c.visits + 1e-3, 1.0 / temperature));
+        discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        chosen = children[pick(rng)].move;
+        return true;
+    }
+
+private:
+    // Value is the reward for the player who made the move into this node
+    struct Node
+    {
+        atomic<uint64_t> valueSum{0};
+        atomic<uint32_t> visits{0};
+        atomic<uint32_t> children{0}; // First child index, valid once state is EXPANDED
+        float prior = 0;
+        Move move = {0, 0};
+        atomic<uint8_t> state{UNEXPANDED};
+        uint8_t count = 0;            // Number of children
+    };
+
+    enum : uint8_t
+    {
+        UNEXPANDED,
+        EXPANDING,
+        EXPANDED
+    };
+
+    MctsConfig config;
+    unique_ptr<Node[]> pool, spare;
+    atomic<size_t> used{0};
+    uint32_t root = 0;
+    Position rootPosition;
+    random_device seedSource;
+
+    uint32_t childCount(uint32_t node) const
+    {
+        return pool[node].state.load(memory_order_acquire) == EXPANDED ? pool[node].count : 0;
+    }
+
+    uint32_t firstChild(uint32_t node) const { return pool[node].children.load(memory_order_relaxed); }
+
+    void reset(const Position &position)
+    {
+        rootPosition = position;
+        root = 0;
+        resetNode(pool[0], Move{0, 0}, 0.f);
+        used = 1;
+    }
+
+    static void resetNode(Node &n, Move move, float prior)
+    {
+        n.valueSum.store(0, memory_order_relaxed);
+        n.visits.store(0, memory_order_relaxed);
+        n.children.store(0, memory_order_relaxed);
+        n.prior = prior;
+        n.move = move;
+        n.count = 0;
+        n.state.store(UNEXPANDED, memory_order_relaxed);
+    }
+
+    // Copies the subtree under the root to the spare pool, breadth first so
+    // every sibling block stays contiguous, then swaps the pools
+    void compact()
+    {
+        vector<pair<uint32_t, uint32_t>> queue = {{root, 0}};
+        size_t next = 1;
+        copyNode(spare[0], pool[root]);
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            uint32_t from = queue[i].first, to = queue[i].second;
+            uint32_t count = childCount(from);
+            spare[to].children.store(uint32_t(next), memory_order_relaxed);
+            for (uint32_t c = 0; c < count; c++)
+            {
+                copyNode(spare[next], pool[firstChild(from) + c]);
+                queue.push_back({firstChild(from) + c, uint32_t(next)});
+                next++;
+            }
+        }
+        swap(pool, spare);
+        root = 0;
+        used = next;
+    }
+
+    static void copyNode(Node &to, const Node &from)
+    {
+        to.valueSum.store(from.valueSum.load(memory_order_relaxed), memory_order_relaxed);
+        to.visits.store(from.visits.load(memory_order_relaxed), memory_order_relaxed);
+        to.prior = from.prior;
+        to.move = from.move;
+        to.count = from.count;
+        to.state.store(from.state.load(memory_order_relaxed), memory_order_relaxed);
+    }
+
+    // One selection, expansion, playout and backup
+    void iterate(mt19937 &rng)
+    {
+        uint32_t path[512];
+        bool moverWhite[512];
+        int depth = 0;
+
+        Position position = rootPosition;
+        uint32_t node = root;
+        pool[node].visits.fetch_add(1, memory_order_relaxed);
+        bool whiteWins = false, over = position.isGameOver(whiteWins);
+
+        while (!over && depth < 511)
+        {
+            uint8_t state = pool[node].state.load(memory_order_acquire);
+            if (state == UNEXPANDED)
+            {
+                uint8_t expected = UNEXPANDED;
+                if (pool[node].visits.load(memory_order_relaxed) >= 2 &&
+                    pool[node].state.compare_exchange_strong(expected, EXPANDING))
+                    expand(node, position);
+                break;
+            }
+            if (state == EXPANDING)
+                break; // Another thread is on it, play out from here
+
+            uint32_t child = select(node);
+            moverWhite[depth] = position.whiteTurn;
+            position.makeMove(pool[child].move);
+            pool[child].visits.fetch_add(1, memory_order_relaxed); // Virtual loss until backup
+            path[depth++] = child;
+            node = child;
+            over = position.isGameOver(whiteWins);
+        }
+
+        // 1 white wins, 0 black wins, 0.5 draw
+        float whiteReward = over ? (whiteWins ? 1.f : 0.f) : playout(position, rng);
+        for (int i = 0; i < depth; i++)
+        {
+            float reward = moverWhite[i] ? whiteReward : 1.f - whiteReward;
+            pool[path[i]].valueSum.fetch_add(uint64_t(reward * MCTS_VALUE_ONE), memory_order_relaxed);
+        }
+    }
+
+    uint32_t select(uint32_t node) const
+    {
+        uint32_t first = firstChild(node), count = pool[node].count;
+        double parentVisits = max<uint32_t>(1, pool[node].visits.load(memory_order_relaxed));
+        double logParent = log(parentVisits), sqrtParent = sqrt(parentVisits);
+
+        uint32_t best = first;
+        double bestScore = -1e300;
+        for (uint32_t c = first; c < first + count; c++)
+        {
+            const Node &n = pool[c];
+            uint32_t visits = n.visits.load(memory_order_relaxed);
+            double q = visits ? double(n.valueSum.load(memory_order_relaxed)) / MCTS_VALUE_ONE / visits : 0.5;
+            double score;
+            if (config.puct)
+                score = q + config.exploration * n.prior * sqrtParent / (1 + visits);
+            else
+                score = visits ? q + config.exploration * sqrt(logParent / visits) : 1e300 - c;
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    void expand(uint32_t node, const Position &position)
+    {
+        MoveList list;
+        position.generateMoves(list);
+        size_t first = list.count ? used.fetch_add(list.count) : 0;
+        if (list.count == 0 || first + list.count > config.nodeCapacity)
+        {
+            // Pool exhausted: leave the node a leaf, it still gets playouts
+            pool[node].state.store(UNEXPANDED, memory_order_release);
+            return;
+        }
+
+        // Priors favour valuable captures, a king capture dominates
+        float total = 0;
+        float weights[MAX_MOVES];
+        for (int i = 0; i < list.count; i++)
+        {
+            int8_t victim = position.board[list.moves[i].to];
+            weights[i] = 1.f + (victim == NO_PIECE ? 0.f : PIECE_VALUE[typeOf(victim)]);
+            total += weights[i];
+        }
+        for (int i = 0; i < list.count; i++)
+            resetNode(pool[first + i], list.moves[i], weights[i] / total);
+
+        pool[node].children.store(uint32_t(first), memory_order_relaxed);
+        pool[node].count = uint8_t(list.count);
+        pool[node].state.store(EXPANDED, memory_order_release);
+    }
+
+    // Plays to the end and returns the reward for white
+    float playout(Position position, mt19937 &rng) const
+    {
+        MoveList list;
+        bool whiteWins = false;
+        for (int ply = 0; ply < config.maxPlayoutPlies; ply++)
+        {
+            if (position.isGameOver(whiteWins))
+                return whiteWins ? 1.f : 0.f;
+            Move m;
+            if (config.playout == PLAYOUT_CAPTURES)
+            {
+                if (!pickCaptureMove(position, rng, m))
+                    return 0.5f;
+            }
+            else
+            {
+                position.generateMoves(list);
+                if (list.count == 0)
+                    return 0.5f;
+                m = list.moves[rng() % list.count];
+            }
+            position.makeMove(m);
+        }
+        return 0.5f;
+    }
+};
@@ -0,0 +1,272 @@
+#pragma once
+#include "Explorer.hpp"
+#include "MappedFile.hpp"
+#include "Position.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A labeled training position in 32 bytes. The occupied squares are one
+// bitboard and their pieces follow as 4-bit PieceIDs in square order, low
+// nibble first. The rules have no promotion, so 32 pieces always fit.
+struct PackedPosition
+{
+    uint64_t occupancy;
+    uint8_t pieces[16];
+    int16_t score; // Centipawns from white's point of view
+    uint16_t ply;  // Plies played in the game before this position
+    uint8_t flags; // Bit 0: white to move, bits 1-2: GameResult
+    uint8_t pad[3];
+
+    bool whiteTurn() const { return flags & 1; }
+    GameResult result() const { return GameResult((flags >> 1) & 3); }
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+inline bool packPosition(const Position &position, int score, int ply, GameResult result, PackedPosition &out)
+{
+    out = PackedPosition();
+    out.occupancy = position.colors[0] | position.colors[1];
+    if (__builtin_popcountll(out.occupancy) > 32)
+        return false;
+    Bitboard occupied = out.occupancy;
+    for (int i = 0; occupied; i++)
+    {
+        int8_t p = position.board[popLowest(occupied)];
+        out.pieces[i >> 1] |= uint8_t(p << ((i & 1) * 4));
+    }
+    out.score = int16_t(max(-32000, min(32000, score)));
+    out.ply = uint16_t(min(ply, 65535));
+    out.flags = uint8_t(position.whiteTurn | (result << 1));
+    return true;
+}
+
+inline void unpackPosition(const PackedPosition &packed, Position &position)
+{
+    for (int sq = 0; sq < 64; sq++)
+        position.board[sq] = NO_PIECE;
+    Bitboard occupied = packed.occupancy;
+    for (int i = 0; occupied; i++)
+        position.board[popLowest(occupied)] = int8_t((packed.pieces[i >> 1] >> ((i & 1) * 4)) & 15);
+    position.whiteTurn = packed.whiteTurn();
+    position.syncBitboards();
+}
+
+// Hash of the board and side to move, the labels are left out so the same
+// position from two games hashes the same
+inline uint64_t packedHash(const PackedPosition &p)
+{
+    uint64_t low, high;
+    memcpy(&low, p.pieces, 8);
+    memcpy(&high, p.pieces + 8, 8);
+    uint64_t state = p.occupancy ^ (p.whiteTurn() ? 0 : ZOBRIST_BLACK_TO_MOVE);
+    state = splitMix(state) ^ low;
+    state = splitMix(state) ^ high;
+    return splitMix(state);
+}
+
+inline bool samePlacement(const PackedPosition &a, const PackedPosition &b)
+{
+    return a.occupancy == b.occupancy && memcmp(a.pieces, b.pieces, sizeof(a.pieces)) == 0 &&
+           a.whiteTurn() == b.whiteTurn();
+}
+
+// A record carrying its packedHash, so sorting by hash computes it once per
+// record instead of twice per comparison
+struct HashedPosition
+{
+    uint64_t hash;
+    PackedPosition position;
+};
+
+inline HashedPosition withHash(const PackedPosition &p) { return HashedPosition{packedHash(p), p}; }
+
+// Orders by hash, then by placement so equal positions end up next to each other
+struct HashedPositionLess
+{
+    bool operator()(const HashedPosition &a, const HashedPosition &b) const
+    {
+        if (a.hash != b.hash)
+            return a.hash < b.hash;
+        const PackedPosition &pa = a.position, &pb = b.position;
+        if (pa.occupancy != pb.occupancy)
+            return pa.occupancy < pb.occupancy;
+        int order = memcmp(pa.pieces, pb.pieces, sizeof(pa.pieces));
+        if (order != 0)
+            return order < 0;
+        return pa.whiteTurn() < pb.whiteTurn();
+    }
+};
+
+// Shard file: a header followed by packed positions
+struct ShardHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+};
+
+const uint32_t SHARD_MAGIC = 0x4B505043; // "CPPK"
+const uint32_t SHARD_VERSION = 1;
+
+class ShardWriter
+{
+public:
+    ~ShardWriter()
+    {
+        if (file)
+            fclose(file);
+    }
+
+    bool open(const string &path)
+    {
+        file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        ShardHeader header = {};
+        count = 0;
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        return ok;
+    }
+
+    void add(const PackedPosition *positions, size_t n)
+    {
+        ok = ok && fwrite(positions, sizeof(PackedPosition), n, file) == n;
+        count += n;
+    }
+
+    void add(const PackedPosition &position) { add(&position, 1); }
+
+    uint64_t positionCount() const { return count; }
+
+    bool close()
+    {
+        ShardHeader header = {SHARD_MAGIC, SHARD_VERSION, count};
+        ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+private:
+    FILE *file = nullptr;
+    uint64_t count = 0;
+    bool ok = true;
+};
+
+// Memory-mapped shard, positions are read in place
+class ShardFile
+{
+public:
+    bool open(const string &path)
+    {
+        if (!mapped.open(path) || mapped.size() < sizeof(ShardHeader))
+            return false;
+        const ShardHeader *header = reinterpret_cast<const ShardHeader *>(mapped.data());
+        if (header->magic != SHARD_MAGIC || header->version != SHARD_VERSION ||
+            mapped.size() != sizeof(ShardHeader) + header->count * sizeof(PackedPosition))
+        {
+            mapped.close();
+            return false;
+        }
+        count = header->count;
+        return true;
+    }
+
+    uint64_t size() const { return count; }
+    const PackedPosition *data() const
+    {
+        return reinterpret_cast<const PackedPosition *>(mapped.data() + sizeof(ShardHeader));
+    }
+
+private:
+    MappedFile mapped;
+    uint64_t count = 0;
+};
+
+// Streams every position of a set of shards once per epoch in random order
+// without holding them all in memory. Shards are cut into blocks that are
+// visited in a shuffled order, and blocks pour into a buffer that hands out
+// a random element each time. Reads stay sequential within a block while
+// neighbours in a file end up far apart in the stream.
+class ShuffledReader
+{
+public:
+    explicit ShuffledReader(size_t bufferPositions = 1 << 20, size_t blockPositions = 4096)
+        : capacity(max<size_t>(bufferPositions, blockPositions)), blockSize(blockPositions)
+    {
+    }
+
+    bool open(const vector<string> &paths)
+    {
+        shards.clear();
+        blocks.clear();
+        total = 0;
+        for (auto &path : paths)
+        {
+            shards.emplace_back(new ShardFile());
+            if (!shards.back()->open(path))
+                return false;
+            uint64_t n = shards.back()->size();
+            for (uint64_t first = 0; first < n; first += blockSize)
+                blocks.push_back(Block{uint32_t(shards.size() - 1), first, min<uint64_t>(blockSize, n - first)});
+            total += n;
+        }
+        reset(0);
+        return true;
+    }
+
+    uint64_t size() const { return total; }
+
+    // Starts a new epoch, the same seed gives the same order
+    void reset(uint64_t seed)
+    {
+        rng.seed(seed);
+        sort(blocks.begin(), blocks.end(),
+             [](const Block &x, const Block &y) { return x.shard != y.shard ? x.shard < y.shard : x.first < y.first; });
+        shuffle(blocks.begin(), blocks.end(), rng);
+        nextBlock = 0;
+        buffer.clear();
+        buffer.reserve(capacity);
+    }
+
+    bool next(PackedPosition &out)
+    {
+        while (nextBlock < blocks.size() && buffer.size() + blockSize <= capacity)
+        {
+            const Block &b = blocks[nextBlock++];
+            const PackedPosition *first = shards[b.shard]->data() + b.first;
+            buffer.insert(buffer.end(), first, first + b.count);
+        }
+        if (buffer.empty())
+            return false;
+        size_t i = uniform_int_distribution<size_t>(0, buffer.size() - 1)(rng);
+        out = buffer[i];
+        buffer[i] = buffer.back();
+        buffer.pop_back();
+        return true;
+    }
+
+private:
+    struct Block
+    {
+        uint32_t shard;
+        uint64_t first, count;
+    };
+
+    size_t capacity, blockSize;
+    vector<unique_ptr<ShardFile>> shards;
+    vector<Block> blocks;
+    size_t nextBlock = 0;
+    uint64_t total = 0;
+    vector<PackedPosition> buffer;
+    mt19937_64 rng;
+};
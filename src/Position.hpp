@@ -0,0 +1,583 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+
+using namespace std;
+
+// Piece codes, also used to index the piece textures
+enum PieceID
+{
+    W_P,
+    W_R,
+    W_N,
+    W_B,
+    W_Q,
+    W_K,
+    B_P,
+    B_R,
+    B_N,
+    B_B,
+    B_Q,
+    B_K
+};
+
+// Piece kinds without color, in the same order as PieceID
+enum PieceType
+{
+    PAWN,
+    ROOK,
+    KNIGHT,
+    BISHOP,
+    QUEEN,
+    KING
+};
+
+const int8_t NO_PIECE = -1;
+
+inline bool isWhitePiece(int8_t id) { return id < B_P; }
+inline PieceType typeOf(int8_t id) { return PieceType(id % 6); }
+inline int8_t makePiece(bool white, PieceType type) { return int8_t(white ? type : type + 6); }
+
+// Squares are row * 8 + col with row 0 at the top, matching the board on screen
+inline int squareOf(int row, int col) { return row * 8 + col; }
+inline int rowOf(int square) { return square >> 3; }
+inline int colOf(int square) { return square & 7; }
+
+struct Move
+{
+    uint8_t from;
+    uint8_t to;
+};
+
+inline bool operator==(Move a, Move b) { return a.from == b.from && a.to == b.to; }
+inline bool operator!=(Move a, Move b) { return !(a == b); }
+
+// Enough for any position, so generation never allocates
+const int MAX_MOVES = 256;
+
+struct MoveList
+{
+    Move moves[MAX_MOVES];
+    int count = 0;
+
+    void add(int from, int to) { moves[count++] = Move{uint8_t(from), uint8_t(to)}; }
+    Move *begin() { return moves; }
+    Move *end() { return moves + count; }
+    const Move *begin() const { return moves; }
+    const Move *end() const { return moves + count; }
+};
+
+typedef uint64_t Bitboard;
+
+inline int popLowest(Bitboard &b)
+{
+    int sq = __builtin_ctzll(b);
+    b &= b - 1;
+    return sq;
+}
+
+// Targets of a fixed step pattern from every square
+template <size_t N>
+constexpr array<Bitboard, 64> stepAttacks(const int (&dx)[N], const int (&dy)[N])
+{
+    array<Bitboard, 64> table = {};
+    for (int sq = 0; sq < 64; sq++)
+        for (size_t i = 0; i < N; i++)
+        {
+            int col = (sq & 7) + dx[i], row = (sq >> 3) + dy[i];
+            if (col >= 0 && col < 8 && row >= 0 && row < 8)
+                table[sq] |= Bitboard(1) << (row * 8 + col);
+        }
+    return table;
+}
+
+constexpr int KNIGHT_DX[8] = {2, 2, -2, -2, 1, 1, -1, -1};
+constexpr int KNIGHT_DY[8] = {1, -1, 1, -1, 2, -2, 2, -2};
+constexpr int KING_DX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+constexpr int KING_DY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+constexpr int PAWN_DX[2] = {-1, 1};
+constexpr int WHITE_PAWN_DY[2] = {-1, -1};
+constexpr int BLACK_PAWN_DY[2] = {1, 1};
+
+constexpr array<Bitboard, 64> KNIGHT_ATTACKS = stepAttacks(KNIGHT_DX, KNIGHT_DY);
+constexpr array<Bitboard, 64> KING_ATTACKS = stepAttacks(KING_DX, KING_DY);
+// Diagonal pawn captures, indexed [white][square]
+constexpr array<Bitboard, 64> PAWN_ATTACKS[2] = {stepAttacks(PAWN_DX, BLACK_PAWN_DY),
+                                                  stepAttacks(PAWN_DX, WHITE_PAWN_DY)};
+
+// Zobrist keys: one per piece and square, plus one for black to move
+constexpr uint64_t splitMix(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr array<uint64_t, 12 * 64 + 1> makeZobristKeys()
+{
+    array<uint64_t, 12 * 64 + 1> keys = {};
+    uint64_t state = 0x43686573734B6579ULL;
+    for (auto &k : keys)
+        k = splitMix(state);
+    return keys;
+}
+
+constexpr array<uint64_t, 12 * 64 + 1> ZOBRIST = makeZobristKeys();
+constexpr uint64_t ZOBRIST_BLACK_TO_MOVE = ZOBRIST[12 * 64];
+
+inline uint64_t zobristKey(int8_t piece, int square) { return ZOBRIST[piece * 64 + square]; }
+
+const Bitboard ROW_2_FROM_TOP = Bitboard(0xFF) << 16; // Black pawns land here after one step
+const Bitboard ROW_5_FROM_TOP = Bitboard(0xFF) << 40; // White pawns land here after one step
+
+// Board state without any SFML objects, so games can run headless. The GUI
+// and the tools share its rules: no castling, en passant or promotion, and
+// the game ends when a king is captured.
+//
+// board[] is the mailbox view, pieces[] and colors[] hold the same state as
+// bitboards so move generation can walk one piece kind at a time. key is the
+// Zobrist hash of the whole position and is kept up to date by makeMove.
+class Position
+{
+public:
+    int8_t board[64];
+    Bitboard pieces[12];
+    Bitboard colors[2]; // Indexed by white
+    bool whiteTurn;
+    uint64_t key;
+
+    Position() { setStart(); }
+
+    void setStart()
+    {
+        const PieceType backRank[8] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+        for (int sq = 0; sq < 64; sq++)
+            board[sq] = NO_PIECE;
+        for (int c = 0; c < 8; c++)
+        {
+            board[squareOf(0, c)] = makePiece(false, backRank[c]);
+            board[squareOf(1, c)] = B_P;
+            board[squareOf(6, c)] = W_P;
+            board[squareOf(7, c)] = makePiece(true, backRank[c]);
+        }
+        whiteTurn = true;
+        syncBitboards();
+    }
+
+    // Rebuilds the bitboards and the key after board[] or whiteTurn was written directly
+    void syncBitboards()
+    {
+        for (auto &b : pieces)
+            b = 0;
+        colors[0] = colors[1] = 0;
+        key = whiteTurn ? 0 : ZOBRIST_BLACK_TO_MOVE;
+        for (int sq = 0; sq < 64; sq++)
+            if (board[sq] != NO_PIECE)
+            {
+                pieces[board[sq]] |= Bitboard(1) << sq;
+                colors[isWhitePiece(board[sq])] |= Bitboard(1) << sq;
+                key ^= zobristKey(board[sq], sq);
+            }
+    }
+
+    int8_t at(int row, int col) const { return board[squareOf(row, col)]; }
+
+    // Moves for the side to move, the rules the GUI plays by too. The
+    // color is resolved here once and every piece kind runs its own loop.
+    void generateMoves(MoveList &list) const
+    {
+        list.count = 0;
+        if (whiteTurn)
+            generateAll<true>(list);
+        else
+            generateAll<false>(list);
+    }
+
+    // Moves of the piece on one square, the GUI's selection hints and move checks
+    void generatePieceMoves(int square, MoveList &list) const
+    {
+        list.count = 0;
+        int8_t p = board[square];
+        if (p == NO_PIECE)
+            return;
+        Bitboard only = Bitboard(1) << square;
+        if (isWhitePiece(p))
+            generateOne<true>(typeOf(p), only, list);
+        else
+            generateOne<false>(typeOf(p), only, list);
+    }
+
+    bool isLegal(Move m) const
+    {
+        if (m.from >= 64 || m.to >= 64 || board[m.from] == NO_PIECE || isWhitePiece(board[m.from]) != whiteTurn)
+            return false;
+        MoveList list;
+        generatePieceMoves(m.from, list);
+        for (Move candidate : list)
+            if (candidate == m)
+                return true;
+        return false;
+    }
+
+    // Plays a move and passes the turn, returns the captured piece or NO_PIECE
+    int8_t makeMove(Move m)
+    {
+        int8_t moving = board[m.from];
+        int8_t captured = board[m.to];
+        Bitboard fromBit = Bitboard(1) << m.from, toBit = Bitboard(1) << m.to;
+
+        if (captured != NO_PIECE)
+        {
+            pieces[captured] &= ~toBit;
+            colors[isWhitePiece(captured)] &= ~toBit;
+            key ^= zobristKey(captured, m.to);
+        }
+        pieces[moving] ^= fromBit | toBit;
+        colors[isWhitePiece(moving)] ^= fromBit | toBit;
+        key ^= zobristKey(moving, m.from) ^ zobristKey(moving, m.to) ^ ZOBRIST_BLACK_TO_MOVE;
+
+        board[m.to] = moving;
+        board[m.from] = NO_PIECE;
+        whiteTurn = !whiteTurn;
+        return captured;
+    }
+
+    // Same test as checkForWin in main.cpp: a side without a king has lost
+    bool isGameOver(bool &whiteWins) const
+    {
+        bool whiteKing = pieces[W_K] != 0, blackKing = pieces[B_K] != 0;
+        if (!whiteKing || !blackKing)
+        {
+            whiteWins = whiteKing;
+            return true;
+        }
+        return false;
+    }
+
+    // True if a piece of the given color attacks the square
+    bool isAttacked(int square, bool byWhite) const
+    {
+        if (PAWN_ATTACKS[!byWhite][square] & pieces[makePiece(byWhite, PAWN)])
+            return true;
+        if (KNIGHT_ATTACKS[square] & pieces[makePiece(byWhite, KNIGHT)])
+            return true;
+        if (KING_ATTACKS[square] & pieces[makePiece(byWhite, KING)])
+            return true;
+
+        Bitboard straight = pieces[makePiece(byWhite, ROOK)] | pieces[makePiece(byWhite, QUEEN)];
+        Bitboard diagonal = pieces[makePiece(byWhite, BISHOP)] | pieces[makePiece(byWhite, QUEEN)];
+        Bitboard occupied = colors[0] | colors[1];
+        const int dx[] = {0, 0, 1, -1, 1, 1, -1, -1};
+        const int dy[] = {-1, 1, 0, 0, -1, 1, -1, 1};
+        int row = rowOf(square), col = colOf(square);
+
+        for (int dir = 0; dir < 8; dir++)
+        {
+            Bitboard sliders = dir < 4 ? straight : diagonal;
+            if (!sliders)
+                continue;
+            for (int newX = col + dx[dir], newY = row + dy[dir]; newX >= 0 && newX < 8 && newY >= 0 && newY < 8;
+                 newX += dx[dir], newY += dy[dir])
+            {
+                Bitboard bit = Bitboard(1) << squareOf(newY, newX);
+                if (bit & occupied)
+                {
+                    if (bit & sliders)
+                        return true;
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Whether the king of the given color is attacked. The GUI rules never
+    // test this, the mate solver does.
+    bool inCheck(bool white) const
+    {
+        Bitboard king = pieces[makePiece(white, KING)];
+        return king && isAttacked(__builtin_ctzll(king), !white);
+    }
+
+    // Moves that do not leave the mover's own king attacked, as in standard chess
+    void generateLegalMoves(MoveList &list) const
+    {
+        MoveList pseudo;
+        generateMoves(pseudo);
+        list.count = 0;
+        for (Move m : pseudo)
+        {
+            Position child = *this;
+            child.makeMove(m);
+            if (!child.inCheck(whiteTurn))
+                list.moves[list.count++] = m;
+        }
+    }
+
+    // Leaf count of the move tree. A move that captures a king ends the
+    // game and is never a leaf, at any depth.
+    uint64_t perft(int depth) const
+    {
+        bool whiteWins;
+        if (isGameOver(whiteWins))
+            return 0;
+        if (depth == 0)
+            return 1;
+
+        MoveList list;
+        generateMoves(list);
+        if (depth == 1)
+        {
+            // Both kings are on the board here
+            int king = __builtin_ctzll(pieces[makePiece(!whiteTurn, KING)]);
+            uint64_t nodes = list.count;
+            for (Move m : list)
+                nodes -= m.to == king;
+            return nodes;
+        }
+
+        uint64_t nodes = 0;
+        for (Move m : list)
+        {
+            Position child = *this;
+            child.makeMove(m);
+            nodes += child.perft(depth - 1);
+        }
+        return nodes;
+    }
+
+private:
+    void add(MoveList &list, int from, Bitboard targets) const
+    {
+        while (targets)
+            list.add(from, popLowest(targets));
+    }
+
+    template <bool White>
+    void generateAll(MoveList &list) const
+    {
+        generatePawns<White>(pieces[makePiece(White, PAWN)], list);
+        generateSteps<White>(pieces[makePiece(White, KNIGHT)], KNIGHT_ATTACKS, list);
+        generateSlides<White, 0, 4>(pieces[makePiece(White, ROOK)], list);
+        generateSlides<White, 4, 8>(pieces[makePiece(White, BISHOP)], list);
+        generateSlides<White, 0, 8>(pieces[makePiece(White, QUEEN)], list);
+        generateSteps<White>(pieces[makePiece(White, KING)], KING_ATTACKS, list);
+    }
+
+    template <bool White>
+    void generateOne(PieceType type, Bitboard only, MoveList &list) const
+    {
+        switch (type)
+        {
+        case PAWN:
+            generatePawns<White>(only, list);
+            break;
+        case KNIGHT:
+            generateSteps<White>(only, KNIGHT_ATTACKS, list);
+            break;
+        case ROOK:
+            generateSlides<White, 0, 4>(only, list);
+            break;
+        case BISHOP:
+            generateSlides<White, 4, 8>(only, list);
+            break;
+        case QUEEN:
+            generateSlides<White, 0, 8>(only, list);
+            break;
+        case KING:
+            generateSteps<White>(only, KING_ATTACKS, list);
+            break;
+        }
+    }
+
+    template <bool White>
+    void generatePawns(Bitboard pawns, MoveList &list) const
+    {
+        const int forward = White ? -8 : 8;
+        Bitboard empty = ~(colors[0] | colors[1]);
+
+        // Pushes for all pawns at once, one shift per step
+        Bitboard single = (White ? pawns >> 8 : pawns << 8) & empty;
+        Bitboard twice = single & (White ? ROW_5_FROM_TOP : ROW_2_FROM_TOP);
+        twice = (White ? twice >> 8 : twice << 8) & empty;
+        while (single)
+        {
+            int to = popLowest(single);
+            list.add(to - forward, to);
+        }
+        while (twice)
+        {
+            int to = popLowest(twice);
+            list.add(to - 2 * forward, to);
+        }
+
+        while (pawns)
+        {
+            int from = popLowest(pawns);
+            add(list, from, PAWN_ATTACKS[White][from] & colors[!White]);
+        }
+    }
+
+    template <bool White>
+    void generateSteps(Bitboard movers, const array<Bitboard, 64> &attacks, MoveList &list) const
+    {
+        while (movers)
+        {
+            int from = popLowest(movers);
+            add(list, from, attacks[from] & ~colors[White]);
+        }
+    }
+
+    // Rays 0-3 are straight, 4-7 diagonal
+    template <bool White, int FirstRay, int LastRay>
+    void generateSlides(Bitboard movers, MoveList &list) const
+    {
+        static constexpr int dx[] = {0, 0, 1, -1, 1, 1, -1, -1};
+        static constexpr int dy[] = {-1, 1, 0, 0, -1, 1, -1, 1};
+
+        while (movers)
+        {
+            int from = popLowest(movers);
+            int row = rowOf(from), col = colOf(from);
+
+            for (int dir = FirstRay; dir < LastRay; ++dir)
+            {
+                for (int newX = col + dx[dir], newY = row + dy[dir]; newX >= 0 && newX < 8 && newY >= 0 && newY < 8;
+                     newX += dx[dir], newY += dy[dir])
+                {
+                    int to = squareOf(newY, newX);
+                    Bitboard toBit = Bitboard(1) << to;
+                    if (toBit & colors[White])
+                        break;
+                    list.add(from, to);
+                    if (toBit & colors[!White])
+                        break;
+                }
+            }
+        }
+    }
+};
+
+// Fixed material values for choosing moves, indexed by PieceType. The king
+// outranks everything since taking it ends the game.
+const int PIECE_VALUE[6] = {1, 5, 3, 3, 9, 100};
+
+// Capture-first policy of the quick engines and the MCTS playouts: takes a
+// king at once, the most valuable capture on offer half the time, otherwise
+// a random move. Returns false when there is no move.
+inline bool pickCaptureMove(const Position &position, mt19937 &rng, Move &chosen)
+{
+    MoveList list;
+    position.generateMoves(list);
+    if (list.count == 0)
+        return false;
+
+    Move best = list.moves[0];
+    int bestValue = 0;
+    for (Move m : list)
+    {
+        int8_t victim = position.board[m.to];
+        if (victim != NO_PIECE && PIECE_VALUE[typeOf(victim)] > bestValue)
+        {
+            bestValue = PIECE_VALUE[typeOf(victim)];
+            best = m;
+        }
+    }
+    // Skipping captures half the time keeps playouts and games varied
+    if (bestValue == PIECE_VALUE[KING] || (bestValue > 0 && (rng() & 1)))
+        chosen = best;
+    else
+        chosen = list.moves[rng() % list.count];
+    return true;
+}
+
+// Coordinate notation such as "e2e4", rank 1 is the bottom row
+inline string moveToString(Move m)
+{
+    string s;
+    s += char('a' + colOf(m.from));
+    s += char('8' - rowOf(m.from));
+    s += char('a' + colOf(m.to));
+    s += char('8' - rowOf(m.to));
+    return s;
+}
+
+// Reads the piece placement and side to move of a FEN or EPD record. The
+// castling and en passant fields are ignored since the rules have neither.
+inline bool parseFen(const string &fen, Position &position)
+{
+    const string letters = "PRNBQKprnbqk"; // In PieceID order
+    size_t i = 0;
+    int row = 0, col = 0;
+    for (int sq = 0; sq < 64; sq++)
+        position.board[sq] = NO_PIECE;
+
+    for (; i < fen.size() && fen[i] != ' '; i++)
+    {
+        char ch = fen[i];
+        if (ch == '/')
+        {
+            row++;
+            col = 0;
+        }
+        else if (ch >= '1' && ch <= '8')
+            col += ch - '0';
+        else
+        {
+            size_t id = letters.find(ch);
+            if (id == string::npos || row > 7 || col > 7)
+                return false;
+            position.board[squareOf(row, col++)] = int8_t(id);
+        }
+        if (row > 7 || col > 8)
+            return false;
+    }
+    if (row != 7 || i + 1 >= fen.size())
+        return false;
+    position.whiteTurn = fen[i + 1] != 'b';
+    position.syncBitboards();
+    return true;
+}
+
+// Piece placement and side to move, the fields parseFen reads back
+inline string toFen(const Position &position)
+{
+    const string letters = "PRNBQKprnbqk";
+    string fen;
+    for (int row = 0; row < 8; row++)
+    {
+        int empty = 0;
+        for (int col = 0; col < 8; col++)
+        {
+            int8_t p = position.at(row, col);
+            if (p == NO_PIECE)
+            {
+                empty++;
+                continue;
+            }
+            if (empty)
+                fen += char('0' + empty);
+            empty = 0;
+            fen += letters[p];
+        }
+        if (empty)
+            fen += char('0' + empty);
+        if (row < 7)
+            fen += '/';
+    }
+    fen += position.whiteTurn ? " w" : " b";
+    return fen;
+}
+
+inline bool parseMove(const string &s, Move &m)
+{
+    if (s.size() < 4 || s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8' || s[2] < 'a' || s[2] > 'h' ||
+        s[3] < '1' || s[3] > '8')
+        return false;
+    m.from = uint8_t(squareOf('8' - s[1], s[0] - 'a'));
+    m.to = uint8_t(squareOf('8' - s[3], s[2] - 'a'));
+    return true;
+}
@@ -0,0 +1,251 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Configure with -DCHESS_PROFILE=OFF to compile every probe out
+#ifndef CHESS_PROFILE
+#define CHESS_PROFILE 1
+#endif
+
+// Timed sections of the main loop and the engines. A zone records self
+// time: a zone opened inside another, like move_gen inside events, is not
+// counted again in the outer one.
+enum ProfileZone
+{
+    ZONE_EVENTS,
+    ZONE_MOVE_GEN,
+    ZONE_WIN_CHECK,
+    ZONE_DRAW_BOARD,
+    ZONE_DRAW_HINTS,
+    ZONE_DRAW_PIECES,
+    ZONE_DRAW_TEXT,
+    ZONE_SEARCH,
+    ZONE_COUNT
+};
+
+// Plain event counters
+enum ProfileCounter
+{
+    COUNTER_DRAW_CALLS,
+    COUNTER_MOVES_GENERATED,
+    COUNTER_SEARCH_NODES,
+    COUNTER_ALLOCATIONS, // Counted by the GUI's operator new
+    COUNTER_COUNT
+};
+
+const char *const ZONE_NAMES[ZONE_COUNT] = {"events", "move_gen", "win_check", "draw_board",
+                                            "draw_hints", "draw_pieces", "draw_text", "search"};
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {"draw_calls", "moves_generated", "search_nodes", "allocations"};
+
+// One finished frame as seen by the HUD and the dump files. workMs stops
+// before display(), frameMs also covers display() and its frame limit wait.
+struct FrameSample
+{
+    float frameMs;
+    float workMs;
+    float zoneMs[ZONE_COUNT];
+    uint64_t counters[COUNTER_COUNT];
+};
+
+// Collects zone times and counters. Probes may fire from any thread, frames
+// are closed from the main loop only.
+class Profiler
+{
+public:
+    static const size_t HISTORY = 600; // Ten seconds at 60 FPS
+
+    static void addTime(ProfileZone zone, uint64_t nanos)
+    {
+        zoneNanos[zone].fetch_add(nanos, memory_order_relaxed);
+    }
+
+    static void count(ProfileCounter counter, uint64_t n)
+    {
+        counters[counter].fetch_add(n, memory_order_relaxed);
+    }
+
+    // Moves this frame's accumulators into the history ring
+    static void endFrame(float workMs, float frameMs)
+    {
+        FrameSample sample;
+        sample.frameMs = frameMs;
+        sample.workMs = workMs;
+        for (int z = 0; z < ZONE_COUNT; z++)
+            sample.zoneMs[z] = zoneNanos[z].exchange(0, memory_order_relaxed) / 1e6f;
+        for (int c = 0; c < COUNTER_COUNT; c++)
+            sample.counters[c] = counters[c].exchange(0, memory_order_relaxed);
+
+        if (history.size() < HISTORY)
+            history.push_back(sample);
+        else
+            history[next] = sample;
+        next = (next + 1) % HISTORY;
+    }
+
+    static const FrameSample *lastFrame()
+    {
+        if (history.empty())
+            return nullptr;
+        return &history[(next + HISTORY - 1) % HISTORY];
+    }
+
+    static size_t frameCount() { return history.size(); }
+
+    // Frame time percentile over the history window, p in [0, 100]
+    static float frameTimePercentile(float p) { return percentile(&FrameSample::frameMs, p); }
+    static float workTimePercentile(float p) { return percentile(&FrameSample::workMs, p); }
+
+    static float averageZoneMs(ProfileZone zone)
+    {
+        if (history.empty())
+            return 0.f;
+        double sum = 0;
+        for (auto &s : history)
+            sum += s.zoneMs[zone];
+        return (float)(sum / history.size());
+    }
+
+    // One row per frame in the history window, oldest first
+    static bool dumpCsv(const string &path)
+    {
+        ofstream out(path);
+        if (!out)
+            return false;
+
+        out << "frame,frame_ms,work_ms";
+        for (int z = 0; z < ZONE_COUNT; z++)
+            out << "," << ZONE_NAMES[z] << "_ms";
+        for (int c = 0; c < COUNTER_COUNT; c++)
+            out << "," << COUNTER_NAMES[c];
+        out << "\n";
+
+        size_t start = history.size() < HISTORY ? 0 : next;
+        for (size_t i = 0; i < history.size(); i++)
+        {
+            const FrameSample &s = history[(start + i) % history.size()];
+            out << i << "," << s.frameMs << "," << s.workMs;
+            for (int z = 0; z < ZONE_COUNT; z++)
+                out << "," << s.zoneMs[z];
+            for (int c = 0; c < COUNTER_COUNT; c++)
+                out << "," << s.counters[c];
+            out << "\n";
+        }
+        return true;
+    }
+
+    // Summary of the history window for regression tracking
+    static bool dumpJson(const string &path)
+    {
+        ofstream out(path);
+        if (!out)
+            return false;
+
+        out << "{\n  \"frames\": " << history.size() << ",\n";
+        out << "  \"frame_ms\": {\"p50\": " << frameTimePercentile(50) << ", \"p95\": " << frameTimePercentile(95)
+            << ", \"p99\": " << frameTimePercentile(99) << ", \"max\": " << frameTimePercentile(100) << "},\n";
+        out << "  \"work_ms\": {\"p50\": " << workTimePercentile(50) << ", \"p95\": " << workTimePercentile(95)
+            << ", \"p99\": " << workTimePercentile(99) << ", \"max\": " << workTimePercentile(100) << "},\n";
+
+        out << "  \"zone_avg_ms\": {";
+        for (int z = 0; z < ZONE_COUNT; z++)
+            out << (z ? ", " : "") << "\"" << ZONE_NAMES[z] << "\": " << averageZoneMs((ProfileZone)z);
+        out << "},\n";
+
+        out << "  \"counter_avg_per_frame\": {";
+        for (int c = 0; c < COUNTER_COUNT; c++)
+        {
+            double sum = 0;
+            for (auto &s : history)
+                sum += s.counters[c];
+            out << (c ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << (history.empty() ? 0 : sum / history.size());
+        }
+        out << "}\n}\n";
+        return true;
+    }
+
+    // One line of the zone times and counters not yet moved into a frame, for
+    // the headless programs that never call endFrame. Zone times are summed
+    // over threads. Prints nothing when no probe fired.
+    static void dumpTotals(ostream &out)
+    {
+        bool any = false;
+        for (int z = 0; z < ZONE_COUNT; z++)
+            if (uint64_t nanos = zoneNanos[z].load(memory_order_relaxed))
+            {
+                out << (any ? "  " : "Profile:  ") << ZONE_NAMES[z] << " " << nanos / 1e6 << " ms";
+                any = true;
+            }
+        for (int c = 0; c < COUNTER_COUNT; c++)
+            if (uint64_t n = counters[c].load(memory_order_relaxed))
+            {
+                out << (any ? "  " : "Profile:  ") << COUNTER_NAMES[c] << " " << n;
+                any = true;
+            }
+        if (any)
+            out << endl;
+    }
+
+private:
+    static float percentile(float FrameSample::*field, float p)
+    {
+        if (history.empty())
+            return 0.f;
+        vector<float> times;
+        times.reserve(history.size());
+        for (auto &s : history)
+            times.push_back(s.*field);
+        size_t k = min(times.size() - 1, (size_t)(p / 100.f * (times.size() - 1) + 0.5f));
+        nth_element(times.begin(), times.begin() + k, times.end());
+        return times[k];
+    }
+
+    inline static atomic<uint64_t> zoneNanos[ZONE_COUNT] = {};
+    inline static atomic<uint64_t> counters[COUNTER_COUNT] = {};
+    inline static vector<FrameSample> history;
+    inline static size_t next = 0;
+};
+
+// Adds the lifetime of the object to a zone, minus the time spent in timers
+// nested inside it on the same thread
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(ProfileZone zone) : zone(zone), parent(innermost), start(chrono::steady_clock::now())
+    {
+        innermost = this;
+    }
+
+    ~ScopedTimer()
+    {
+        uint64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        Profiler::addTime(zone, elapsed - nestedNanos);
+        if (parent)
+            parent->nestedNanos += elapsed;
+        innermost = parent;
+    }
+
+private:
+    ProfileZone zone;
+    ScopedTimer *parent;
+    uint64_t nestedNanos = 0;
+    chrono::steady_clock::time_point start;
+    inline static thread_local ScopedTimer *innermost = nullptr;
+};
+
+#if CHESS_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(zone) ScopedTimer PROFILE_CONCAT(scopedTimer, __LINE__)(zone)
+#define PROFILE_COUNT(counter, n) Profiler::count(counter, n)
+#else
+#define PROFILE_SCOPE(zone) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#endif
@@ -1,8 +1,19 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include "Piece.hpp"
+#include "Position.hpp"
+#include "Profiler.hpp"
+#include "AssetLoader.hpp"
+#include "Explorer.hpp"
+#include "InputReplay.hpp"
+#include "Benchmark.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <iomanip>
 
 using namespace sf;
 using namespace std;
@@ -17,22 +28,8 @@ const Color BUTTON_COLOR(70, 130, 180);
 const Color BUTTON_HOVER_COLOR(100, 149, 237);
 const Color INPUT_BOX_COLOR(60, 60, 60);
 const Color INPUT_BOX_ACTIVE_COLOR(80, 80, 80);
+const Color HUD_BG_COLOR(0, 0, 0, 170);
 
-enum PieceID
-{
-    W_P,
-    W_R,
-    W_N,
-    W_B,
-    W_Q,
-    W_K,
-    B_P,
-    B_R,
-    B_N,
-    B_B,
-    B_Q,
-    B_K
-};
 enum GameState
 {
     MAIN_MENU,
@@ -40,6 +37,74 @@ enum GameState
     PLAYING
 };
 
+#if CHESS_PROFILE
+// Counts every heap allocation in the process, SFML's included, for the HUD
+// and the benchmark. Every replaceable form of new and delete is replaced,
+// so each delete frees memory from its own allocator. A failed allocation
+// throws or returns null right away, no new_handler is called.
+void *countedAlloc(size_t size) noexcept
+{
+    Profiler::count(COUNTER_ALLOCATIONS, 1);
+    return malloc(size ? size : 1);
+}
+
+// Over-aligned blocks keep the pointer malloc returned just below the
+// aligned address. aligned_alloc would do, but MSVC lacks it.
+void *countedAlignedAlloc(size_t size, align_val_t alignment) noexcept
+{
+    size_t align = max(size_t(alignment), sizeof(void *));
+    char *raw = static_cast<char *>(countedAlloc(size + align + sizeof(void *)));
+    if (!raw)
+        return nullptr;
+    uintptr_t start = uintptr_t(raw + sizeof(void *));
+    void **aligned = reinterpret_cast<void **>((start + align - 1) & ~uintptr_t(align - 1));
+    aligned[-1] = raw;
+    return aligned;
+}
+
+void alignedFree(void *p) noexcept
+{
+    if (p)
+        free(static_cast<void **>(p)[-1]);
+}
+
+void *orThrow(void *p)
+{
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size) { return orThrow(countedAlloc(size)); }
+void *operator new[](size_t size) { return orThrow(countedAlloc(size)); }
+void *operator new(size_t size, align_val_t alignment) { return orThrow(countedAlignedAlloc(size, alignment)); }
+void *operator new[](size_t size, align_val_t alignment) { return orThrow(countedAlignedAlloc(size, alignment)); }
+void *operator new(size_t size, const nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept { return countedAlignedAlloc(size, alignment); }
+void *operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept { return countedAlignedAlloc(size, alignment); }
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete(void *p, align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p, align_val_t) noexcept { alignedFree(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept { alignedFree(p); }
+void operator delete(void *p, align_val_t, const nothrow_t &) noexcept { alignedFree(p); }
+void operator delete[](void *p, align_val_t, const nothrow_t &) noexcept { alignedFree(p); }
+#endif
+
+// Draws through the target and counts the call for the profiler HUD
+void drawCounted(RenderTarget &target, const Drawable &drawable)
+{
+    target.draw(drawable);
+    PROFILE_COUNT(COUNTER_DRAW_CALLS, 1);
+}
+
 class Button
 {
 public:
@@ -76,10 +141,10 @@ public:
         return shape.getGlobalBounds().contains(mousePos);
     }
 
-    void draw(RenderWindow &window)
+    void draw(RenderTarget &target)
     {
-        window.draw(shape);
-        window.draw(text);
+        drawCounted(target, shape);
+        drawCounted(target, text);
     }
 };
 
@@ -164,16 +229,17 @@ public:
         }
     }
 
-    void draw(RenderWindow &window)
+    void draw(RenderTarget &target)
     {
-        window.draw(shape);
-        window.draw(label);
-        window.draw(text);
+        drawCounted(target, shape);
+        drawCounted(target, label);
+        drawCounted(target, text);
     }
 };
 
 bool checkForWin(Piece *board[8][8], bool &whiteWins)
 {
+    PROFILE_SCOPE(ZONE_WIN_CHECK);
     bool whiteKing = false, blackKing = false;
     for (int r = 0; r < 8; r++)
         for (int c = 0; c < 8; c++)
@@ -252,19 +318,126 @@ Vector2i getBoardPos(Vector2f mouse, float startX, float startY, float tileSize)
     return (col >= 0 && col < 8 && row >= 0 && row < 8) ? Vector2i(col, row) : Vector2i(-1, -1);
 }
 
-int main()
+// Lists the archive's moves for the current position next to the board
+void updateExplorerText(Text &explorerText, const ExplorerIndex &explorer, const Position &position)
 {
-    RenderWindow window(VideoMode(1000, 800), "Chess");
-    window.setFramerateLimit(60);
+    if (!explorer.isOpen())
+        return; // Not drawn either
+    ostringstream text;
+    text << "Explorer\n";
+    vector<ExplorerEntry> entries = explorer.lookup(position.key);
+    if (entries.empty())
+        text << "No games";
+    for (size_t i = 0; i < entries.size() && i < 12; i++)
+    {
+        const ExplorerEntry &e = entries[i];
+        uint32_t wins = position.whiteTurn ? e.whiteWins : e.blackWins;
+        int score = (int)(100.0 * (wins + e.draws / 2.0) / e.games() + 0.5);
+        text << moveToString(Move{e.from, e.to}) << "  " << e.games() << "  " << score << "%\n";
+    }
+    explorerText.setString(text.str());
+}
+
+// Refreshes the profiler overlay from the frame history
+void updateHud(Text &hudText)
+{
+    ostringstream hud;
+    hud << fixed << setprecision(2);
+    hud << "frame ms  p50 " << Profiler::frameTimePercentile(50)
+        << "  p95 " << Profiler::frameTimePercentile(95)
+        << "  p99 " << Profiler::frameTimePercentile(99) << "\n";
+    hud << "work ms   p50 " << Profiler::workTimePercentile(50)
+        << "  p95 " << Profiler::workTimePercentile(95)
+        << "  p99 " << Profiler::workTimePercentile(99) << "\n";
+    if (const FrameSample *last = Profiler::lastFrame())
+        hud << "draw calls " << last->counters[COUNTER_DRAW_CALLS] << "  allocations "
+            << last->counters[COUNTER_ALLOCATIONS] << "\n";
+    for (int z = 0; z < ZONE_COUNT; z++)
+        hud << ZONE_NAMES[z] << "  " << Profiler::averageZoneMs((ProfileZone)z) << "\n";
+    hud << "F4: dump profile.csv / profile.json";
+    hudText.setString(hud.str());
+}
+
+void printUsage()
+{
+    cout << "Usage: Chess [--record FILE]\n"
+         << "       Chess --bench FILE [--bench-out FILE] [--baseline FILE] [--tolerance PERCENT]\n"
+         << "--record saves the mouse and keyboard input of a session. --bench replays such a\n"
+         << "recording into an offscreen texture as fast as possible and reports frame time\n"
+         << "percentiles, draw calls and allocations per frame. Without a display, run it\n"
+         << "under a virtual X server, e.g. xvfb-run -a Chess --bench FILE.\n";
+}
+
+int main(int argc, char **argv)
+{
+    string recordPath, benchPath, benchOut = "bench.json", baselinePath;
+    double tolerance = 10;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--bench" && i + 1 < argc)
+            benchPath = argv[++i];
+        else if (arg == "--bench-out" && i + 1 < argc)
+            benchOut = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // The benchmark draws the same frames into a texture and takes its input
+    // from a recording, so it runs unthrottled and needs no visible window
+    bool benchmark = !benchPath.empty();
+    InputReplay replay;
+    InputRecorder recorder;
+    vector<FrameSample> benchFrames;
+    RenderWindow window;
+    RenderTexture offscreen;
+    if (benchmark)
+    {
+        if (!replay.load(benchPath))
+        {
+            cerr << "Cannot read recording " << benchPath << "\n";
+            return 1;
+        }
+        if (!offscreen.create(1000, 800))
+        {
+            cerr << "Cannot create an offscreen render texture\n";
+            return 1;
+        }
+    }
+    else
+    {
+        window.create(VideoMode(1000, 800), "Chess");
+        window.setFramerateLimit(60);
+        if (!recordPath.empty() && !recorder.open(recordPath))
+        {
+            cerr << "Cannot write " << recordPath << "\n";
+            return 1;
+        }
+    }
+    RenderTarget &target = benchmark ? static_cast<RenderTarget &>(offscreen) : window;
+    Vector2u targetSize = target.getSize();
+    bool running = true;
+    uint64_t frameIndex = 0;
 
-    // Set window icon
-    Image icon;
-    if (icon.loadFromFile("Assets/icon.png"))
-        window.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
+    // Piece images and the icon decode in the background while the menu is up
+    AssetLoader assets;
+    assets.start();
 
     Font font;
     if (!font.loadFromFile("Anton-Regular.ttf"))
+    {
+        cerr << "Cannot load Anton-Regular.ttf from the working directory\n";
         return -1;
+    }
 
     // Game state variables
     GameState gameState = MAIN_MENU;
@@ -274,8 +447,8 @@ int main()
     float tileSize = 80.f;
     float boardWidth = tileSize * 8;
     float boardHeight = tileSize * 8;
-    float boardStartX = (window.getSize().x - boardWidth) / 2.0f;
-    float boardStartY = (window.getSize().y - boardHeight) / 2.0f;
+    float boardStartX = (targetSize.x - boardWidth) / 2.0f;
+    float boardStartY = (targetSize.y - boardHeight) / 2.0f;
 
     // Main Menu Elements
     Text titleText("CHESS GAME", font, 48);
@@ -283,22 +456,22 @@ int main()
     titleText.setStyle(Text::Bold);
     FloatRect titleBounds = titleText.getLocalBounds();
     titleText.setOrigin(titleBounds.left + titleBounds.width / 2.0f, titleBounds.top + titleBounds.height / 2.0f);
-    titleText.setPosition(window.getSize().x / 2.0f, 150);
+    titleText.setPosition(targetSize.x / 2.0f, 150);
 
-    Button newGameButton(Vector2f(200, 60), Vector2f(window.getSize().x / 2.0f - 100, 250), "New Game", font);
-    Button exitButton(Vector2f(200, 60), Vector2f(window.getSize().x / 2.0f - 100, 330), "Exit", font);
+    Button newGameButton(Vector2f(200, 60), Vector2f(targetSize.x / 2.0f - 100, 250), "New Game", font);
+    Button exitButton(Vector2f(200, 60), Vector2f(targetSize.x / 2.0f - 100, 330), "Exit", font);
 
     // Name Input Elements
     Text nameInputTitle("Enter Player Names", font, 36);
     nameInputTitle.setFillColor(Color::White);
     FloatRect nameInputBounds = nameInputTitle.getLocalBounds();
     nameInputTitle.setOrigin(nameInputBounds.left + nameInputBounds.width / 2.0f, nameInputBounds.top + nameInputBounds.height / 2.0f);
-    nameInputTitle.setPosition(window.getSize().x / 2.0f, 200);
+    nameInputTitle.setPosition(targetSize.x / 2.0f, 200);
 
-    InputBox player1Input(Vector2f(300, 40), Vector2f(window.getSize().x / 2.0f - 150, 280), "Player 1 (White):", font);
-    InputBox player2Input(Vector2f(300, 40), Vector2f(window.getSize().x / 2.0f - 150, 360), "Player 2 (Black):", font);
-    Button startGameButton(Vector2f(200, 60), Vector2f(window.getSize().x / 2.0f - 100, 450), "Start Game", font);
-    Button backButton(Vector2f(200, 60), Vector2f(window.getSize().x / 2.0f - 100, 530), "Back", font);
+    InputBox player1Input(Vector2f(300, 40), Vector2f(targetSize.x / 2.0f - 150, 280), "Player 1 (White):", font);
+    InputBox player2Input(Vector2f(300, 40), Vector2f(targetSize.x / 2.0f - 150, 360), "Player 2 (Black):", font);
+    Button startGameButton(Vector2f(200, 60), Vector2f(targetSize.x / 2.0f - 100, 450), "Start Game", font);
+    Button backButton(Vector2f(200, 60), Vector2f(targetSize.x / 2.0f - 100, 530), "Back", font);
 
     // Game Elements
     RectangleShape board[8][8];
@@ -310,19 +483,7 @@ int main()
             board[r][c].setFillColor((r + c) % 2 == 0 ? Color(118, 150, 86) : Color(238, 238, 210));
         }
 
-    Texture textures[12];
-    textures[W_P].loadFromFile("Assets/White Pieces/Pawn.png");
-    textures[W_R].loadFromFile("Assets/White Pieces/Rook.png");
-    textures[W_N].loadFromFile("Assets/White Pieces/Knight.png");
-    textures[W_B].loadFromFile("Assets/White Pieces/Bishop.png");
-    textures[W_Q].loadFromFile("Assets/White Pieces/Queen.png");
-    textures[W_K].loadFromFile("Assets/White Pieces/King.png");
-    textures[B_P].loadFromFile("Assets/Black Pieces/Pawn.png");
-    textures[B_R].loadFromFile("Assets/Black Pieces/Rook.png");
-    textures[B_N].loadFromFile("Assets/Black Pieces/Knight.png");
-    textures[B_B].loadFromFile("Assets/Black Pieces/Bishop.png");
-    textures[B_Q].loadFromFile("Assets/Black Pieces/Queen.png");
-    textures[B_K].loadFromFile("Assets/Black Pieces/King.png");
+    Texture textures[PIECE_TEXTURE_COUNT];
 
     Piece *pieces[8][8] = {nullptr};
 
@@ -344,27 +505,78 @@ int main()
     p1Text.setPosition(boardStartX, boardStartY - 40);
     p2Text.setPosition(boardStartX + boardWidth - 200, boardStartY - 40);
 
+    // Opening explorer beside the board, shown when chess-index has built an
+    // index. The benchmark leaves it closed so local files never change its numbers.
+    ExplorerIndex explorer;
+    if (!benchmark)
+        explorer.open("explorer.idx");
+    Text explorerText("", font, 18);
+    explorerText.setPosition(boardStartX + boardWidth + 15, boardStartY);
+    explorerText.setFillColor(Color::White);
+
+    // Headless mirror of the board, used for explorer lookups and the game archive
+    Position gamePosition;
+    vector<Move> gameMoves;
+
     Button menuButton(Vector2f(120, 40), Vector2f(boardStartX + boardWidth - 120, boardStartY + boardHeight + 20), "Main Menu", font);
 
     RectangleShape winMessageBg(Vector2f(600, 200));
     winMessageBg.setFillColor(WIN_MESSAGE_BG_COLOR);
-    winMessageBg.setPosition((window.getSize().x - 600) / 2.f, (window.getSize().y - 200) / 2.f);
+    winMessageBg.setPosition((targetSize.x - 600) / 2.f, (targetSize.y - 200) / 2.f);
 
     Text winMessage("", font, 46);
     winMessage.setFillColor(Color::White);
 
-    RectangleShape menuBackground(Vector2f(window.getSize().x, window.getSize().y));
+    RectangleShape menuBackground(Vector2f(targetSize.x, targetSize.y));
     menuBackground.setFillColor(MENU_BG_COLOR);
 
-    while (window.isOpen())
+    // Profiler overlay, toggled with F3
+    bool showHud = false;
+    Clock frameClock;
+    RectangleShape hudBg(Vector2f(300, 210));
+    hudBg.setFillColor(HUD_BG_COLOR);
+    hudBg.setPosition(10, 10);
+    Text hudText("", font, 14);
+    hudText.setFillColor(Color::White);
+    hudText.setPosition(18, 16);
+
+    // The benchmark waits for the textures here, so the upload lands outside
+    // the timed frames however long decoding took and every run draws the same
+    if (benchmark)
+        assets.upload(textures, window, true);
+
+    while (running)
     {
-        Vector2f mousePos = window.mapPixelToCoords(Mouse::getPosition(window));
+        assets.upload(textures, window);
+
+        Vector2i mousePixel;
+        if (benchmark)
+        {
+            replay.beginFrame();
+            mousePixel = replay.mouse();
+        }
+        else
+            mousePixel = Mouse::getPosition(window);
+        if (recorder.isOpen())
+            recorder.beginFrame(frameIndex, mousePixel);
+        Vector2f mousePos = target.mapPixelToCoords(mousePixel);
 
         Event event;
-        while (window.pollEvent(event))
+        while (benchmark ? replay.pollEvent(event) : window.pollEvent(event))
         {
+            PROFILE_SCOPE(ZONE_EVENTS);
+            if (recorder.isOpen())
+                recorder.record(event);
             if (event.type == Event::Closed)
-                window.close();
+                running = false;
+
+            if (event.type == Event::KeyPressed && event.key.code == Keyboard::F3)
+                showHud = !showHud;
+            if (event.type == Event::KeyPressed && event.key.code == Keyboard::F4)
+            {
+                Profiler::dumpCsv("profile.csv");
+                Profiler::dumpJson("profile.json");
+            }
 
             if (gameState == MAIN_MENU)
             {
@@ -381,7 +593,7 @@ int main()
                     }
                     else if (exitButton.isClicked(mousePos))
                     {
-                        window.close();
+                        running = false;
                     }
                 }
             }
@@ -412,8 +624,12 @@ int main()
                             player2Name = player2Input.content;
                             gameState = PLAYING;
 
-                            // Initialize game
+                            // Initialize game, waiting for the textures if decoding is still running
+                            assets.upload(textures, window, true);
                             setupPieces(pieces, textures, boardStartX, boardStartY, tileSize);
+                            gamePosition.setStart();
+                            gameMoves.clear();
+                            updateExplorerText(explorerText, explorer, gamePosition);
                             whiteTurn = true;
                             pieceSelected = false;
                             gameOver = false;
@@ -456,6 +672,9 @@ int main()
                 {
                     cleanupPieces(pieces);
                     setupPieces(pieces, textures, boardStartX, boardStartY, tileSize);
+                    gamePosition.setStart();
+                    gameMoves.clear();
+                    updateExplorerText(explorerText, explorer, gamePosition);
                     whiteTurn = true;
                     pieceSelected = false;
                     gameOver = false;
@@ -486,7 +705,16 @@ int main()
                                 {
                                     selected = pos;
                                     pieceSelected = true;
-                                    moves = p->getLegalMoves(pos, pieces);
+                                    moves.clear();
+                                    {
+                                        // Same rules as every engine, from the mirrored position
+                                        PROFILE_SCOPE(ZONE_MOVE_GEN);
+                                        MoveList list;
+                                        gamePosition.generatePieceMoves(squareOf(pos.y, pos.x), list);
+                                        for (Move m : list)
+                                            moves.push_back(Vector2i(m.to % 8, m.to / 8));
+                                    }
+                                    PROFILE_COUNT(COUNTER_MOVES_GENERATED, moves.size());
                                     moveHints.clear();
                                     for (auto &m : moves)
                                     {
@@ -513,14 +741,20 @@ int main()
                                         pieces[selected.y][selected.x] = nullptr;
                                         pieces[pos.y][pos.x]->setPosition(Vector2f(boardStartX + pos.x * tileSize + tileSize / 2, boardStartY + pos.y * tileSize + tileSize / 2));
 
+                                        Move played = {uint8_t(squareOf(selected.y, selected.x)), uint8_t(squareOf(pos.y, pos.x))};
+                                        gamePosition.makeMove(played);
+                                        gameMoves.push_back(played);
+
                                         if (checkForWin(pieces, whiteWins))
                                         {
                                             gameOver = true;
+                                            if (!benchmark)
+                                                appendGame("games.txt", gameMoves, whiteWins ? RESULT_WHITE_WINS : RESULT_BLACK_WINS);
                                             string winner = whiteWins ? player1Name + " Wins!" : player2Name + " Wins!";
                                             winMessage.setString(winner);
                                             FloatRect rect = winMessage.getLocalBounds();
                                             winMessage.setOrigin(rect.left + rect.width / 2.f, rect.top + rect.height / 2.f);
-                                            winMessage.setPosition(window.getSize().x / 2.f, window.getSize().y / 2.f);
+                                            winMessage.setPosition(targetSize.x / 2.f, targetSize.y / 2.f);
                                         }
                                         else
                                         {
@@ -528,6 +762,7 @@ int main()
                                             turnText.setString("Turn: " + (whiteTurn ? player1Name : player2Name));
                                             p1Text.setStyle(whiteTurn ? Text::Bold : Text::Regular);
                                             p2Text.setStyle(whiteTurn ? Text::Regular : Text::Bold);
+                                            updateExplorerText(explorerText, explorer, gamePosition);
                                         }
                                         break;
                                     }
@@ -542,55 +777,114 @@ int main()
             }
         }
 
-        window.clear(BACKGROUND_COLOR);
+        target.clear(BACKGROUND_COLOR);
 
         if (gameState == MAIN_MENU)
         {
-            window.draw(menuBackground);
-            window.draw(titleText);
-            newGameButton.draw(window);
-            exitButton.draw(window);
+            PROFILE_SCOPE(ZONE_DRAW_TEXT);
+            drawCounted(target, menuBackground);
+            drawCounted(target, titleText);
+            newGameButton.draw(target);
+            exitButton.draw(target);
         }
         else if (gameState == NAME_INPUT)
         {
-            window.draw(menuBackground);
-            window.draw(nameInputTitle);
-            player1Input.draw(window);
-            player2Input.draw(window);
-            startGameButton.draw(window);
-            backButton.draw(window);
+            PROFILE_SCOPE(ZONE_DRAW_TEXT);
+            drawCounted(target, menuBackground);
+            drawCounted(target, nameInputTitle);
+            player1Input.draw(target);
+            player2Input.draw(target);
+            startGameButton.draw(target);
+            backButton.draw(target);
         }
         else if (gameState == PLAYING)
         {
-            for (auto &row : board)
-                for (auto &tile : row)
-                    window.draw(tile);
+            {
+                PROFILE_SCOPE(ZONE_DRAW_BOARD);
+                for (auto &row : board)
+                    for (auto &tile : row)
+                        drawCounted(target, tile);
+            }
 
-            for (auto &h : moveHints)
-                window.draw(h);
-            if (pieceSelected)
-                window.draw(selectionHighlight);
+            {
+                PROFILE_SCOPE(ZONE_DRAW_HINTS);
+                for (auto &h : moveHints)
+                    drawCounted(target, h);
+                if (pieceSelected)
+                    drawCounted(target, selectionHighlight);
+            }
 
-            for (int r = 0; r < 8; r++)
-                for (int c = 0; c < 8; c++)
-                    if (pieces[r][c])
-                        window.draw(pieces[r][c]->getSprite());
+            {
+                PROFILE_SCOPE(ZONE_DRAW_PIECES);
+                for (int r = 0; r < 8; r++)
+                    for (int c = 0; c < 8; c++)
+                        if (pieces[r][c])
+                            drawCounted(target, pieces[r][c]->getSprite());
+            }
 
-            window.draw(p1Text);
-            window.draw(p2Text);
-            window.draw(turnText);
-            menuButton.draw(window);
+            PROFILE_SCOPE(ZONE_DRAW_TEXT);
+            drawCounted(target, p1Text);
+            drawCounted(target, p2Text);
+            drawCounted(target, turnText);
+            if (explorer.isOpen())
+                drawCounted(target, explorerText);
+            menuButton.draw(target);
 
             if (gameOver)
             {
-                window.draw(winMessageBg);
-                window.draw(winMessage);
+                drawCounted(target, winMessageBg);
+                drawCounted(target, winMessage);
             }
         }
 
-        window.display();
+        if (showHud)
+        {
+            updateHud(hudText);
+            drawCounted(target, hudBg);
+            drawCounted(target, hudText);
+        }
+
+        // Work time ends here, display() may sleep for the frame limit
+        float workMs = frameClock.getElapsedTime().asMicroseconds() / 1000.f;
+        if (benchmark)
+            offscreen.display();
+        else
+            window.display();
+        Profiler::endFrame(workMs, frameClock.restart().asMicroseconds() / 1000.f);
+        frameIndex++;
+
+        if (benchmark)
+        {
+            benchFrames.push_back(*Profiler::lastFrame());
+            if (replay.finished())
+                running = false;
+        }
     }
 
     cleanupPieces(pieces);
-    return 0;
+    if (window.isOpen())
+        window.close();
+    if (!benchmark)
+        return 0;
+
+    // Frame 0 sets up the GL state of the texture and rasterizes the menu glyphs, keep it out of the numbers
+    if (benchFrames.size() > 1)
+        benchFrames.erase(benchFrames.begin());
+    BenchReport report = BenchReport::fromFrames(benchFrames);
+    report.print(cout);
+    if (!report.save(benchOut))
+        cerr << "Cannot write " << benchOut << "\n";
+    if (baselinePath.empty())
+        return 0;
+
+    BenchReport baseline;
+    if (!baseline.load(baselinePath))
+    {
+        cerr << "Cannot read baseline " << baselinePath << "\n";
+        return 1;
+    }
+    cout << "Against " << baselinePath << ":\n";
+    bool ok = report.compare(baseline, tolerance / 100, cout);
+    cout << (ok ? "No regressions" : "Regressions beyond the tolerance") << endl;
+    return ok ? 0 : 2;
 }
\ No newline at end of file
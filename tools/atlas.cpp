@@ -0,0 +1,26 @@
+#include "AssetLoader.hpp"
+#include <iostream>
+
+using namespace std;
+
+// Decodes every PNG in Assets/ and writes Assets/pieces.atlas, which the GUI
+// reads instead of the PNGs. Run from the directory holding Assets/; the
+// build does this whenever one of the PNGs changes.
+int main()
+{
+    vector<Image> images(PIECE_TEXTURE_COUNT + 1);
+    for (int i = 0; i <= PIECE_TEXTURE_COUNT; i++)
+    {
+        if (!images[i].loadFromFile(ASSET_PATHS[i]))
+        {
+            cerr << "Cannot decode " << ASSET_PATHS[i] << endl;
+            return 1;
+        }
+    }
+    if (!writeAtlas(images))
+    {
+        cerr << "Cannot write " << ATLAS_PATH << endl;
+        return 1;
+    }
+    return 0;
+}
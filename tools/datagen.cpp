@@ -0,0 +1,299 @@
+#include "Evaluation.hpp"
+#include "Mcts.hpp"
+#include "PackedPosition.hpp"
+#include "ExternalSort.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct GenerateOptions
+{
+    string output;
+    uint64_t games = 1000;
+    int threads = 1;
+    uint64_t seed = 1;
+    int playouts = 0;
+    int maxPlies = 300;
+    int skipPlies = 8;
+};
+
+// Self-play games. Positions of a game are kept until it ends so they can
+// be labeled with its result, then written out as one batch.
+int generate(const GenerateOptions &options)
+{
+    ShardWriter writer;
+    if (!writer.open(options.output))
+    {
+        cerr << "Cannot write " << options.output << "\n";
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    mutex writeLock;
+    atomic<uint64_t> nextGame(0);
+    auto work = [&](int thread)
+    {
+        mt19937 rng(uint32_t(options.seed * 1000003 + thread));
+        unique_ptr<Mcts> mcts;
+        if (options.playouts > 0)
+        {
+            MctsConfig config;
+            config.nodeCapacity = max<size_t>(1024, size_t(options.playouts) * 40);
+            mcts.reset(new Mcts(config));
+        }
+        vector<Position> positions;
+        vector<int> scores;
+        vector<PackedPosition> packed;
+
+        while (nextGame++ < options.games)
+        {
+            Position position;
+            positions.clear();
+            scores.clear();
+            GameResult result = RESULT_DRAW;
+            bool whiteWins;
+
+            for (int ply = 0; ply < options.maxPlies; ply++)
+            {
+                if (position.isGameOver(whiteWins))
+                {
+                    result = whiteWins ? RESULT_WHITE_WINS : RESULT_BLACK_WINS;
+                    break;
+                }
+                Move m;
+                int score = evaluate(position);
+                if (mcts)
+                {
+                    // Root value as a win probability, mapped to centipawns with the usual logistic
+                    MctsLimits limits;
+                    limits.threads = 1;
+                    limits.playouts = options.playouts;
+                    mcts->setPosition(position);
+                    mcts->search(limits);
+                    vector<MctsChild> children = mcts->rootChildren();
+                    if (!mcts->sampleMove(ply < options.skipPlies ? 1.f : 0.f, rng, m))
+                        break;
+                    double p = min(0.99, max(0.01, double(children[0].score)));
+                    int cp = int(400 * log10(p / (1 - p)));
+                    score = position.whiteTurn ? cp : -cp;
+                }
+                else if (!pickCaptureMove(position, rng, m))
+                    break; // No move left, the game is a draw
+
+                if (ply >= options.skipPlies)
+                {
+                    positions.push_back(position);
+                    scores.push_back(score);
+                }
+                position.makeMove(m);
+            }
+
+            packed.clear();
+            for (size_t i = 0; i < positions.size(); i++)
+            {
+                PackedPosition p;
+                if (packPosition(positions[i], scores[i], options.skipPlies + int(i), result, p))
+                    packed.push_back(p);
+            }
+            lock_guard<mutex> lock(writeLock);
+            writer.add(packed.data(), packed.size());
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < options.threads; t++)
+        threads.emplace_back(work, t);
+    work(0);
+    for (auto &t : threads)
+        t.join();
+
+    if (!writer.close())
+    {
+        cerr << "Failed to write " << options.output << "\n";
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Wrote " << writer.positionCount() << " positions from " << options.games << " games to "
+         << options.output << " in " << seconds << " s" << endl;
+    Profiler::dumpTotals(cout);
+    return 0;
+}
+
+// Sorts all shards by position hash in bounded memory and keeps one record
+// per position: the mean score and the most common result of its copies
+int dedup(const string &output, const vector<string> &inputs, size_t memoryMb, const string &tempDir)
+{
+    auto start = chrono::steady_clock::now();
+    ExternalSorter<HashedPosition, HashedPositionLess> sorter(memoryMb << 20, tempDir);
+    uint64_t read = 0;
+    for (auto &path : inputs)
+    {
+        ShardFile shard;
+        if (!shard.open(path))
+        {
+            cerr << "Cannot read shard " << path << "\n";
+            return 1;
+        }
+        for (uint64_t i = 0; i < shard.size(); i++)
+            sorter.add(withHash(shard.data()[i]));
+        read += shard.size();
+    }
+
+    ShardWriter writer;
+    if (!writer.open(output))
+    {
+        cerr << "Cannot write " << output << "\n";
+        return 1;
+    }
+    PackedPosition pending = {};
+    int64_t scoreSum = 0;
+    uint64_t copies = 0, resultCounts[3] = {};
+    auto flush = [&]()
+    {
+        pending.score = int16_t(scoreSum / int64_t(copies));
+        int result = int(max_element(resultCounts, resultCounts + 3) - resultCounts);
+        pending.flags = uint8_t((pending.flags & 1) | (result << 1));
+        writer.add(pending);
+    };
+    bool sorted = sorter.finish([&](const HashedPosition &hashed) {
+        const PackedPosition &p = hashed.position;
+        if (copies && !samePlacement(p, pending))
+        {
+            flush();
+            copies = 0;
+        }
+        if (copies == 0)
+        {
+            pending = p;
+            scoreSum = 0;
+            resultCounts[0] = resultCounts[1] = resultCounts[2] = 0;
+        }
+        scoreSum += p.score;
+        resultCounts[p.result()]++;
+        pending.ply = min(pending.ply, p.ply);
+        copies++;
+    });
+    if (copies)
+        flush();
+
+    if (!sorted || !writer.close())
+    {
+        cerr << "Failed to write " << output << "\n";
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Read " << read << " positions, wrote " << writer.positionCount() << " unique to " << output << " ("
+         << sorter.runCount() << " spilled runs) in " << seconds << " s" << endl;
+    return 0;
+}
+
+// Reads the shards back in shuffled order and prints the first few
+int sample(const vector<string> &inputs, uint64_t seed, int show)
+{
+    ShuffledReader reader;
+    if (!reader.open(inputs))
+    {
+        cerr << "Cannot read shards\n";
+        return 1;
+    }
+    reader.reset(seed);
+
+    auto start = chrono::steady_clock::now();
+    const char *results[] = {"1-0", "1/2-1/2", "0-1"};
+    uint64_t count = 0, resultCounts[3] = {};
+    double scoreSum = 0;
+    PackedPosition packed;
+    Position position;
+    while (reader.next(packed))
+    {
+        if (count < uint64_t(show))
+        {
+            unpackPosition(packed, position);
+            cout << toFen(position) << "  score " << packed.score << "  " << results[packed.result()] << "  ply "
+                 << packed.ply << "\n";
+        }
+        resultCounts[packed.result()]++;
+        scoreSum += packed.score;
+        count++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << count << " positions in " << seconds << " s, mean score " << (count ? scoreSum / count : 0) << ", results "
+         << resultCounts[0] << " / " << resultCounts[1] << " / " << resultCounts[2] << endl;
+    return count == reader.size() ? 0 : 1;
+}
+
+void printUsage()
+{
+    cout << "Usage: chess-data generate -o SHARD [--games N] [--threads N] [--seed N]\n"
+         << "                           [--playouts N] [--max-plies N] [--skip-plies N]\n"
+         << "       chess-data dedup -o SHARD [--memory MB] [--temp DIR] SHARD...\n"
+         << "       chess-data sample [--seed N] [--show N] SHARD...\n"
+         << "generate writes self-play positions labeled with a score and the game result.\n"
+         << "Scores are the static evaluation unless --playouts searches each move with MCTS.\n"
+         << "dedup merges shards and keeps each position once; sample streams them shuffled.\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return 1;
+    }
+    string command = argv[1];
+    GenerateOptions options;
+    options.threads = max(1u, thread::hardware_concurrency());
+    size_t memoryMb = 1024;
+    string tempDir;
+    int show = 10;
+    vector<string> inputs;
+
+    for (int i = 2; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            options.output = argv[++i];
+        else if (arg == "--games" && i + 1 < argc)
+            options.games = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--playouts" && i + 1 < argc)
+            options.playouts = atoi(argv[++i]);
+        else if (arg == "--max-plies" && i + 1 < argc)
+            options.maxPlies = atoi(argv[++i]);
+        else if (arg == "--skip-plies" && i + 1 < argc)
+            options.skipPlies = atoi(argv[++i]);
+        else if (arg == "--memory" && i + 1 < argc)
+            memoryMb = atol(argv[++i]);
+        else if (arg == "--temp" && i + 1 < argc)
+            tempDir = argv[++i];
+        else if (arg == "--show" && i + 1 < argc)
+            show = atoi(argv[++i]);
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else
+            inputs.push_back(arg);
+    }
+
+    if (command == "generate" && !options.output.empty())
+        return generate(options);
+    if (command == "dedup" && !options.output.empty() && !inputs.empty())
+        return dedup(options.output, inputs, memoryMb, tempDir);
+    if (command == "sample" && !inputs.empty())
+        return sample(inputs, options.seed, show);
+    printUsage();
+    return command == "--help" ? 0 : 1;
+}
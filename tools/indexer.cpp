@@ -0,0 +1,157 @@
+#include "Explorer.hpp"
+#include "ExternalSort.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One move played from one position in one game
+struct PositionMoveRecord
+{
+    uint64_t key;
+    uint8_t from, to, result;
+    uint8_t pad[5];
+};
+
+struct RecordLess
+{
+    bool operator()(const PositionMoveRecord &a, const PositionMoveRecord &b) const
+    {
+        if (a.key != b.key)
+            return a.key < b.key;
+        if (a.from != b.from)
+            return a.from < b.from;
+        return a.to < b.to;
+    }
+};
+
+void printUsage()
+{
+    cout << "Usage: chess-index -o INDEX [--max-ply N] [--memory MB] [--temp DIR] ARCHIVE...\n"
+         << "Replays every game in the archives and writes an opening explorer index.\n"
+         << "--max-ply limits how deep into each game positions are indexed (default 40, 0 = all).\n";
+}
+
+int main(int argc, char **argv)
+{
+    string output, tempDir;
+    int maxPly = 40;
+    size_t memoryMb = 1024;
+    vector<string> archives;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--max-ply" && i + 1 < argc)
+            maxPly = atoi(argv[++i]);
+        else if (arg == "--memory" && i + 1 < argc)
+            memoryMb = atol(argv[++i]);
+        else if (arg == "--temp" && i + 1 < argc)
+            tempDir = argv[++i];
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else
+            archives.push_back(arg);
+    }
+    if (output.empty() || archives.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    ExternalSorter<PositionMoveRecord, RecordLess> sorter(memoryMb << 20, tempDir);
+    uint64_t games = 0, records = 0, rejected = 0;
+
+    for (auto &path : archives)
+    {
+        ifstream in(path);
+        if (!in)
+        {
+            cerr << "Cannot open " << path << "\n";
+            return 1;
+        }
+
+        string line;
+        vector<Move> moves;
+        GameResult result = RESULT_DRAW;
+        while (getline(in, line))
+        {
+            if (!parseGame(line, moves, result))
+            {
+                rejected += !line.empty();
+                continue;
+            }
+
+            Position position;
+            for (size_t ply = 0; ply < moves.size() && (maxPly == 0 || (int)ply < maxPly); ply++)
+            {
+                if (!position.isLegal(moves[ply]))
+                    break;
+                PositionMoveRecord record = {};
+                record.key = position.key;
+                record.from = moves[ply].from;
+                record.to = moves[ply].to;
+                record.result = result;
+                sorter.add(record);
+                records++;
+                position.makeMove(moves[ply]);
+            }
+            games++;
+        }
+    }
+    cout << "Replayed " << games << " games (" << rejected << " unreadable lines), " << records << " moves in "
+         << sorter.runCount() << " spilled runs" << endl;
+
+    // Runs come back grouped by (key, move), fold each group into one entry
+    ExplorerWriter writer;
+    if (!writer.open(output))
+    {
+        cerr << "Cannot write " << output << "\n";
+        return 1;
+    }
+    ExplorerEntry pending = {};
+    bool hasPending = false;
+    bool sorted = sorter.finish([&](const PositionMoveRecord &r) {
+        if (hasPending && (r.key != pending.key || r.from != pending.from || r.to != pending.to))
+        {
+            writer.add(pending);
+            hasPending = false;
+        }
+        if (!hasPending)
+        {
+            pending = ExplorerEntry();
+            pending.key = r.key;
+            pending.from = r.from;
+            pending.to = r.to;
+            hasPending = true;
+        }
+        if (r.result == RESULT_WHITE_WINS)
+            pending.whiteWins++;
+        else if (r.result == RESULT_BLACK_WINS)
+            pending.blackWins++;
+        else
+            pending.draws++;
+    });
+    if (hasPending)
+        writer.add(pending);
+
+    if (!sorted || !writer.close())
+    {
+        cerr << "Failed to write " << output << "\n";
+        return 1;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Wrote " << writer.entryCount() << " entries to " << output << " in " << seconds << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "MateSolver.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Puzzle
+{
+    string id;
+    string fen;
+    Position position;
+    int expectedMate = 0; // From the EPD "dm" opcode, 0 if absent
+    MateResult result;
+};
+
+// EPD: four FEN fields, then opcodes such as 'dm 3;' and 'id "name";'
+bool parseEpd(const string &line, Puzzle &puzzle)
+{
+    istringstream in(line);
+    string placement, side, castling, enPassant;
+    if (!(in >> placement >> side >> castling >> enPassant))
+        return false;
+    puzzle.fen = placement + " " + side;
+    if (!parseFen(puzzle.fen, puzzle.position))
+        return false;
+
+    string rest;
+    getline(in, rest);
+    istringstream ops(rest);
+    string op;
+    while (getline(ops, op, ';'))
+    {
+        istringstream fields(op);
+        string name, value;
+        fields >> name;
+        getline(fields >> ws, value);
+        if (name == "dm")
+            puzzle.expectedMate = atoi(value.c_str());
+        else if (name == "id")
+            puzzle.id = value.size() >= 2 && value.front() == '"' ? value.substr(1, value.size() - 2) : value;
+    }
+    return true;
+}
+
+void printUsage()
+{
+    cout << "Usage: chess-mate [--threads N] [--max-moves N] [--max-nodes N] [--hash MB] FILE.epd\n"
+         << "Solves every position for the shortest mate by the side to move. The limit\n"
+         << "is the EPD 'dm' value when present, otherwise --max-moves (default 5).\n";
+}
+
+int main(int argc, char **argv)
+{
+    int threadCount = max(1u, thread::hardware_concurrency());
+    int maxMoves = 5;
+    uint64_t maxNodes = 20000000;
+    size_t hashMb = 64;
+    string path;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else if (arg == "--max-moves" && i + 1 < argc)
+            maxMoves = atoi(argv[++i]);
+        else if (arg == "--max-nodes" && i + 1 < argc)
+            maxNodes = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hash" && i + 1 < argc)
+            hashMb = atol(argv[++i]);
+        else if (arg[0] != '-' && path.empty())
+            path = arg;
+        else
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (path.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    ifstream in(path);
+    if (!in)
+    {
+        cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    vector<Puzzle> puzzles;
+    string line;
+    for (int lineNumber = 1; getline(in, line); lineNumber++)
+    {
+        Puzzle puzzle;
+        if (line.empty() || line[0] == '#')
+            continue;
+        if (!parseEpd(line, puzzle))
+        {
+            cerr << "Skipping unreadable line " << lineNumber << "\n";
+            continue;
+        }
+        if (puzzle.id.empty())
+            puzzle.id = "line " + to_string(lineNumber);
+        puzzles.push_back(puzzle);
+    }
+
+    // Each thread takes the next unsolved puzzle with its own solver and table
+    auto start = chrono::steady_clock::now();
+    atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        MateSolver solver(hashMb);
+        for (size_t i = next++; i < puzzles.size(); i = next++)
+        {
+            Puzzle &p = puzzles[i];
+            p.result = solver.solve(p.position, p.expectedMate ? p.expectedMate : maxMoves, maxNodes);
+        }
+    };
+    vector<thread> threads;
+    for (int t = 1; t < threadCount; t++)
+        threads.emplace_back(work);
+    work();
+    for (auto &t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int solved = 0, mismatched = 0, unknown = 0;
+    cout << fixed << setprecision(1);
+    for (auto &p : puzzles)
+    {
+        const MateResult &r = p.result;
+        cout << p.id << "  ";
+        if (r.verdict == MATE_FOUND)
+        {
+            cout << "mate in " << r.mateIn << "  " << moveToString(r.firstMove);
+            solved++;
+            if (p.expectedMate && r.mateIn != p.expectedMate)
+            {
+                cout << "  (expected " << p.expectedMate << ")";
+                mismatched++;
+            }
+        }
+        else if (r.verdict == NO_MATE)
+        {
+            cout << "no mate";
+            mismatched += p.expectedMate != 0;
+        }
+        else
+        {
+            cout << "unknown (node limit)";
+            unknown++;
+        }
+        cout << "  " << r.nodes << " nodes  " << r.seconds * 1000 << " ms\n";
+    }
+    cout << solved << "/" << puzzles.size() << " mates found, " << mismatched << " disagree with dm, " << unknown
+         << " hit the node limit; " << setprecision(2) << seconds << " s on " << threadCount << " threads\n";
+    Profiler::dumpTotals(cout);
+    return mismatched || unknown ? 2 : 0;
+}
@@ -0,0 +1,97 @@
+#include "Mcts.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+void printUsage()
+{
+    cout << "Usage: chess-mcts [--threads N] [--ms N] [--playouts N] [--uct] [--random-playouts]\n"
+         << "                  [--nodes N] [--selfplay PLIES] [MOVE...]\n"
+         << "Analyses the position after the given moves (e.g. e2e4 e7e5), or plays\n"
+         << "PLIES moves against itself reusing the tree between moves.\n";
+}
+
+void printStats(const MctsStats &stats)
+{
+    cout << stats.playouts << " playouts in " << stats.seconds << " s  (" << uint64_t(stats.playoutsPerSecond)
+         << " /s), tree " << stats.nodes << " nodes, " << stats.treeBytes / 1024 << " KiB of "
+         << stats.poolBytes / 1024 << " KiB in two pools" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    MctsConfig config;
+    MctsLimits limits;
+    limits.threads = max(1u, thread::hardware_concurrency());
+    limits.milliseconds = 1000;
+    int selfPlay = 0;
+    Position position;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        Move m;
+        if (arg == "--threads" && i + 1 < argc)
+            limits.threads = atoi(argv[++i]);
+        else if (arg == "--ms" && i + 1 < argc)
+            limits.milliseconds = atoi(argv[++i]);
+        else if (arg == "--playouts" && i + 1 < argc)
+        {
+            limits.playouts = atol(argv[++i]);
+            limits.milliseconds = 0;
+        }
+        else if (arg == "--nodes" && i + 1 < argc)
+        {
+            config.nodeCapacity = strtoull(argv[++i], nullptr, 10);
+            if (config.nodeCapacity < MCTS_MIN_NODES)
+            {
+                cerr << "--nodes must be at least " << MCTS_MIN_NODES << endl;
+                return 1;
+            }
+        }
+        else if (arg == "--selfplay" && i + 1 < argc)
+            selfPlay = atoi(argv[++i]);
+        else if (arg == "--uct")
+            config.puct = false;
+        else if (arg == "--random-playouts")
+            config.playout = PLAYOUT_RANDOM;
+        else if (parseMove(arg, m) && position.isLegal(m))
+            position.makeMove(m);
+        else
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Mcts mcts(config);
+    mcts.setPosition(position);
+
+    if (selfPlay == 0)
+    {
+        printStats(mcts.search(limits));
+        for (auto &child : mcts.rootChildren())
+            cout << moveToString(child.move) << "  visits " << child.visits << "  score " << child.score << "\n";
+        Profiler::dumpTotals(cout);
+        return 0;
+    }
+
+    bool whiteWins;
+    for (int ply = 0; ply < selfPlay && !mcts.position().isGameOver(whiteWins); ply++)
+    {
+        MctsStats stats = mcts.search(limits);
+        Move best;
+        if (!mcts.bestMove(best))
+            break;
+        cout << ply + 1 << ". " << moveToString(best) << "  ";
+        printStats(stats);
+        mcts.advance(best);
+    }
+    if (mcts.position().isGameOver(whiteWins))
+        cout << (whiteWins ? "White" : "Black") << " wins" << endl;
+    Profiler::dumpTotals(cout);
+    return 0;
+}
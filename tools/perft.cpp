@@ -0,0 +1,27 @@
+#include "Position.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+// Counts move tree leaves from the start position to check and time move
+// generation. Games end when a king is captured, so counts differ from
+// standard chess perft tables.
+int main(int argc, char **argv)
+{
+    int maxDepth = argc > 1 ? atoi(argv[1]) : 5;
+
+    Position position;
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        auto start = chrono::steady_clock::now();
+        uint64_t nodes = position.perft(depth);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "depth " << depth << "  nodes " << nodes << "  " << seconds << " s";
+        if (seconds > 0)
+            cout << "  " << uint64_t(nodes / seconds) << " nodes/s";
+        cout << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,663 @@
+#include "Evaluation.hpp"
+#include "PackedPosition.hpp"
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// One weight per piece kind and square (piece value plus square bonus)
+// and one for the tempo. Black features point at the same weights with a
+// minus sign, stored as an offset of PARAM_COUNT into a negated copy.
+const int PARAM_COUNT = 6 * 64 + 1;
+const int TEMPO_PARAM = 6 * 64;
+const int ZERO_FEATURE = 2 * PARAM_COUNT; // Padding slot, always weighs 0
+const int MAX_SLOTS = 33;                 // 32 pieces and the tempo
+
+inline int featureOf(int8_t piece, int square)
+{
+    bool white = isWhitePiece(piece);
+    int index = typeOf(piece) * 64 + evalSquare(white, square);
+    return white ? index : index + PARAM_COUNT;
+}
+
+// Positions in struct-of-arrays form. features[slot * count + i] is slot
+// slot of position i, so every pass walks whole arrays front to back. The
+// evaluation and sigmoid loops vectorize over positions; the gradient
+// scatter cannot, since positions in one vector may share a feature.
+struct TuningSet
+{
+    size_t count = 0;
+    int slots = 0;
+    vector<uint16_t> features;
+    vector<float> result; // 1 white wins, 0.5 draw, 0 black wins
+    vector<float> score;  // Label score in centipawns, white's view
+    vector<float> target;
+
+    void load(const vector<PackedPosition> &positions)
+    {
+        count = positions.size();
+        slots = 1;
+        for (auto &p : positions)
+            slots = max(slots, 1 + __builtin_popcountll(p.occupancy));
+        features.assign(size_t(slots) * count, ZERO_FEATURE);
+        result.resize(count);
+        score.resize(count);
+        target.resize(count);
+
+        const float results[] = {1.f, 0.5f, 0.f};
+        Position position;
+        for (size_t i = 0; i < count; i++)
+        {
+            unpackPosition(positions[i], position);
+            features[i] = uint16_t(position.whiteTurn ? TEMPO_PARAM : TEMPO_PARAM + PARAM_COUNT);
+            Bitboard occupied = positions[i].occupancy;
+            for (int slot = 1; occupied; slot++)
+            {
+                int sq = popLowest(occupied);
+                features[size_t(slot) * count + i] = uint16_t(featureOf(position.board[sq], sq));
+            }
+            result[i] = results[positions[i].result()];
+            score[i] = positions[i].score;
+        }
+    }
+
+    // Blend of game result and label score, both as white's win probability
+    void setTargets(float lambda, double k)
+    {
+        for (size_t i = 0; i < count; i++)
+            target[i] = lambda * result[i] + (1 - lambda) * float(1 / (1 + pow(10.0, -k * score[i] / 400)));
+    }
+};
+
+struct Weights
+{
+    vector<double> w = vector<double>(PARAM_COUNT);
+
+    // The layout the evaluation loops index: weights, negated weights, zero
+    void extend(vector<float> &ext) const
+    {
+        ext.assign(2 * PARAM_COUNT + 1, 0.f);
+        for (int j = 0; j < PARAM_COUNT; j++)
+        {
+            ext[j] = float(w[j]);
+            ext[j + PARAM_COUNT] = -float(w[j]);
+        }
+    }
+};
+
+Weights loadCurrentWeights()
+{
+    Weights weights;
+    for (int type = 0; type < 6; type++)
+        for (int sq = 0; sq < 64; sq++)
+            weights.w[type * 64 + sq] = EVAL_PIECE_VALUE[type] + EVAL_PIECE_SQUARE[type][sq];
+    weights.w[TEMPO_PARAM] = EVAL_TEMPO;
+    return weights;
+}
+
+// e^x as a polynomial on [-ln 2 / 2, ln 2 / 2] times a power of two built
+// in the exponent bits. Unlike expf it is plain arithmetic, so the loop
+// that calls it vectorizes. Relative error below 1e-7 for |x| <= 87.
+inline float vectorExp(float x)
+{
+    x = x < -87.f ? -87.f : (x > 87.f ? 87.f : x);
+    const float shifter = 12582912.f; // 1.5 * 2^23, leaves round(x / ln 2) in the low bits
+    float t = x * 1.44269504f + shifter;
+    float n = t - shifter;
+    float r = x - n * 0.693359375f + n * 2.12194440e-4f;
+    float p = ((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r + 4.1665795894e-2f) * r +
+               1.6666665459e-1f) * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.f;
+
+    int32_t bits, power;
+    memcpy(&bits, &t, sizeof(bits));
+    power = (bits - 0x4B400000) * (1 << 23);
+    memcpy(&bits, &p, sizeof(bits));
+    bits += power;
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+// Per-thread sums for one pass over a range of positions
+struct Partial
+{
+    double loss = 0;
+    vector<double> gradient;             // d loss / d extended weight
+    vector<double> normal, projected;    // Gauss-Newton J^T J and J^T r
+    vector<float> eval, slope;
+
+    explicit Partial(bool gaussNewton) : gradient(2 * PARAM_COUNT + 1)
+    {
+        if (gaussNewton)
+        {
+            normal.resize(size_t(PARAM_COUNT) * PARAM_COUNT);
+            projected.resize(PARAM_COUNT);
+        }
+    }
+
+    void clear()
+    {
+        loss = 0;
+        fill(gradient.begin(), gradient.end(), 0.0);
+        fill(normal.begin(), normal.end(), 0.0);
+        fill(projected.begin(), projected.end(), 0.0);
+    }
+};
+
+class Tuner
+{
+public:
+    // The helper threads live as long as the tuner and sleep between
+    // passes, the calling thread takes the last range of every pass
+    Tuner(const TuningSet &set, int threadCount, double k) : set(set), threadCount(max(1, threadCount)), k(k)
+    {
+        for (int t = 0; t + 1 < this->threadCount; t++)
+            helpers.emplace_back([this, t]() { helperLoop(t); });
+    }
+
+    ~Tuner()
+    {
+        {
+            lock_guard<mutex> lock(m);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto &th : helpers)
+            th.join();
+    }
+
+    void setK(double value) { k = value; }
+
+    // Mean squared error of the whole set
+    double loss(const Weights &weights)
+    {
+        run(weights, 0, set.count, false, false);
+        return total.loss / double(set.count);
+    }
+
+    // Gradient of the mean squared error over [begin, end)
+    vector<double> gradient(const Weights &weights, size_t begin, size_t end, double &batchLoss)
+    {
+        run(weights, begin, end, true, false);
+        batchLoss = total.loss / double(end - begin);
+        return foldGradient(total.gradient, 1.0 / double(end - begin));
+    }
+
+    // One damped Gauss-Newton step over the whole set, returns the loss before it
+    double gaussNewtonStep(Weights &weights, double damping)
+    {
+        run(weights, 0, set.count, false, true);
+        int n = PARAM_COUNT;
+        vector<double> a = total.normal, b(n);
+        for (int j = 0; j < n; j++)
+        {
+            a[size_t(j) * n + j] += damping * (1 + a[size_t(j) * n + j]);
+            b[j] = -total.projected[j];
+        }
+        choleskySolve(a, b, n);
+        for (int j = 0; j < n; j++)
+            weights.w[j] += b[j];
+        return total.loss / double(set.count);
+    }
+
+private:
+    const TuningSet &set;
+    int threadCount;
+    double k;
+    vector<Partial> partials;
+    Partial total = Partial(false);
+    vector<float> ext;
+
+    // The pass the helpers are woken for, guarded by m
+    vector<thread> helpers;
+    mutex m;
+    condition_variable wake, done;
+    uint64_t generation = 0;
+    int pending = 0;
+    bool quit = false;
+    size_t jobBegin = 0, jobEnd = 0;
+    bool jobGradient = false, jobGaussNewton = false;
+
+    // Thread t's share of the current pass
+    void work(int t)
+    {
+        size_t chunk = (jobEnd - jobBegin + threadCount - 1) / threadCount;
+        size_t lo = min(jobEnd, jobBegin + t * chunk), hi = min(jobEnd, lo + chunk);
+        pass(ext, lo, hi, jobGradient, jobGaussNewton, partials[t]);
+    }
+
+    void helperLoop(int t)
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [&]() { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+            work(t);
+            {
+                lock_guard<mutex> lock(m);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    // Splits [begin, end) over the threads, then adds up their partials
+    void run(const Weights &weights, size_t begin, size_t end, bool wantGradient, bool gaussNewton)
+    {
+        if (partials.empty() || (gaussNewton && partials[0].normal.empty()))
+        {
+            partials.assign(threadCount, Partial(gaussNewton));
+            total = Partial(gaussNewton);
+        }
+        weights.extend(ext);
+        {
+            lock_guard<mutex> lock(m);
+            jobBegin = begin;
+            jobEnd = end;
+            jobGradient = wantGradient;
+            jobGaussNewton = gaussNewton;
+            pending = threadCount - 1;
+            generation++;
+        }
+        wake.notify_all();
+        work(threadCount - 1);
+        {
+            unique_lock<mutex> lock(m);
+            done.wait(lock, [&]() { return pending == 0; });
+        }
+
+        total.clear();
+        for (auto &p : partials)
+        {
+            total.loss += p.loss;
+            if (wantGradient)
+                for (size_t j = 0; j < p.gradient.size(); j++)
+                    total.gradient[j] += p.gradient[j];
+            if (gaussNewton)
+            {
+                for (size_t j = 0; j < p.normal.size(); j++)
+                    total.normal[j] += p.normal[j];
+                for (size_t j = 0; j < p.projected.size(); j++)
+                    total.projected[j] += p.projected[j];
+            }
+        }
+    }
+
+    void pass(const vector<float> &ext, size_t lo, size_t hi, bool wantGradient, bool gaussNewton, Partial &out) const
+    {
+        out.clear();
+        if (lo >= hi)
+            return;
+        size_t n = hi - lo;
+        out.eval.assign(n, 0.f);
+        out.slope.resize(n);
+        float *eval = out.eval.data();
+        float *slope = out.slope.data();
+        const float *w = ext.data();
+
+        // Evaluations, one slot of every position at a time. The weight
+        // loads are gathers: real ones with AVX2, scalar loads without.
+        for (int s = 0; s < set.slots; s++)
+        {
+            const uint16_t *f = set.features.data() + size_t(s) * set.count + lo;
+#pragma omp simd
+            for (size_t i = 0; i < n; i++)
+                eval[i] += w[f[i]];
+        }
+
+        // Error and d sigmoid / d eval, kept in slope. The loss is summed
+        // in float per block, which lets the loop vectorize, and the blocks
+        // in double.
+        const float scale = float(k * log(10.0) / 400);
+        const float *target = set.target.data() + lo;
+        const size_t LOSS_BLOCK = 4096;
+        double loss = 0;
+        for (size_t block = 0; block < n; block += LOSS_BLOCK)
+        {
+            size_t blockEnd = min(n, block + LOSS_BLOCK);
+            float blockLoss = 0;
+#pragma omp simd reduction(+ : blockLoss)
+            for (size_t i = block; i < blockEnd; i++)
+            {
+                float sigmoid = 1.f / (1.f + vectorExp(-scale * eval[i]));
+                float error = sigmoid - target[i];
+                blockLoss += error * error;
+                float derivative = sigmoid * (1 - sigmoid) * scale;
+                slope[i] = wantGradient ? 2 * error * derivative : derivative;
+                eval[i] = error;
+            }
+            loss += blockLoss;
+        }
+        out.loss = loss;
+
+        if (wantGradient)
+            for (int s = 0; s < set.slots; s++)
+            {
+                const uint16_t *f = set.features.data() + size_t(s) * set.count + lo;
+                for (size_t i = 0; i < n; i++)
+                    out.gradient[f[i]] += slope[i];
+            }
+
+        if (gaussNewton)
+            for (size_t i = 0; i < n; i++)
+            {
+                // Sparse Jacobian row: +-1 per feature, a white and a black
+                // piece on mirrored squares cancel out
+                int index[MAX_SLOTS], coefficient[MAX_SLOTS], used = 0;
+                for (int s = 0; s < set.slots; s++)
+                {
+                    int f = set.features[size_t(s) * set.count + lo + i];
+                    if (f == ZERO_FEATURE)
+                        continue;
+                    int j = f % PARAM_COUNT, c = f < PARAM_COUNT ? 1 : -1, u = 0;
+                    while (u < used && index[u] != j)
+                        u++;
+                    if (u == used)
+                    {
+                        index[used] = j;
+                        coefficient[used++] = 0;
+                    }
+                    coefficient[u] += c;
+                }
+                double d = slope[i], d2 = d * d;
+                for (int u = 0; u < used; u++)
+                {
+                    if (coefficient[u] == 0)
+                        continue;
+                    out.projected[index[u]] += d * coefficient[u] * eval[i];
+                    double *row = out.normal.data() + size_t(index[u]) * PARAM_COUNT;
+                    for (int v = 0; v < used; v++)
+                        row[index[v]] += d2 * coefficient[u] * coefficient[v];
+                }
+            }
+    }
+
+    static vector<double> foldGradient(const vector<double> &ext, double scale)
+    {
+        vector<double> g(PARAM_COUNT);
+        for (int j = 0; j < PARAM_COUNT; j++)
+            g[j] = (ext[j] - ext[j + PARAM_COUNT]) * scale;
+        return g;
+    }
+
+    // Solves a x = b in place for a symmetric positive definite a
+    static void choleskySolve(vector<double> &a, vector<double> &b, int n)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            double *rj = a.data() + size_t(j) * n;
+            for (int c = 0; c < j; c++)
+                rj[j] -= rj[c] * rj[c];
+            rj[j] = sqrt(max(rj[j], 1e-12));
+            for (int r = j + 1; r < n; r++)
+            {
+                double *rr = a.data() + size_t(r) * n;
+                for (int c = 0; c < j; c++)
+                    rr[j] -= rr[c] * rj[c];
+                rr[j] /= rj[j];
+            }
+        }
+        for (int r = 0; r < n; r++)
+        {
+            for (int c = 0; c < r; c++)
+                b[r] -= a[size_t(r) * n + c] * b[c];
+            b[r] /= a[size_t(r) * n + r];
+        }
+        for (int r = n - 1; r >= 0; r--)
+        {
+            for (int c = r + 1; c < n; c++)
+                b[r] -= a[size_t(c) * n + r] * b[c];
+            b[r] /= a[size_t(r) * n + r];
+        }
+    }
+};
+
+// The scaling constant that best fits the current weights to the results,
+// found with a golden section search
+double fitK(TuningSet &set, const Weights &weights, int threads, float lambda)
+{
+    Tuner tuner(set, threads, 1);
+    auto lossAt = [&](double k)
+    {
+        set.setTargets(lambda, k);
+        tuner.setK(k);
+        return tuner.loss(weights);
+    };
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    double lo = 0.05, hi = 5;
+    double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+    double la = lossAt(a), lb = lossAt(b);
+    for (int i = 0; i < 30; i++)
+    {
+        if (la < lb)
+        {
+            hi = b;
+            b = a;
+            lb = la;
+            a = hi - ratio * (hi - lo);
+            la = lossAt(a);
+        }
+        else
+        {
+            lo = a;
+            a = b;
+            la = lb;
+            b = lo + ratio * (hi - lo);
+            lb = lossAt(b);
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+// Splits each piece-square weight into a piece value (the mean over the
+// squares) and a bonus, and writes them in the format of EvalParams.hpp
+bool writeHeader(const string &path, const Weights &weights, const string &command)
+{
+    ofstream out(path);
+    if (!out)
+        return false;
+    int values[6];
+    for (int type = 0; type < 6; type++)
+    {
+        double sum = 0;
+        for (int sq = 0; sq < 64; sq++)
+            sum += weights.w[type * 64 + sq];
+        values[type] = int(lround(sum / 64));
+    }
+
+    out << "// Generated by chess-tune, do not edit by hand. Regenerate with\n"
+        << "//   chess-tune -o src/EvalParams.hpp SHARD...\n"
+        << "// These values came from: " << command << "\n"
+        << "#pragma once\n\n"
+        << "// Centipawns, in PieceType order\n"
+        << "const int EVAL_PIECE_VALUE[6] = {";
+    for (int type = 0; type < 6; type++)
+        out << (type ? ", " : "") << values[type];
+    out << "};\n\n"
+        << "// Bonus per PieceType and square from white's side, row 0 is rank 8\n"
+        << "const int EVAL_PIECE_SQUARE[6][64] = {\n";
+    for (int type = 0; type < 6; type++)
+    {
+        out << "    {";
+        for (int sq = 0; sq < 64; sq++)
+        {
+            if (sq)
+                out << (sq % 8 == 0 ? ",\n     " : ", ");
+            out << lround(weights.w[type * 64 + sq]) - values[type];
+        }
+        out << (type < 5 ? "},\n" : "}};\n\n");
+    }
+    out << "// Bonus for the side to move\n"
+        << "const int EVAL_TEMPO = " << lround(weights.w[TEMPO_PARAM]) << ";\n";
+    return bool(out);
+}
+
+void printUsage()
+{
+    cout << "Usage: chess-tune -o HEADER [--epochs N] [--threads N] [--max-positions N]\n"
+         << "                  [--gauss-newton] [--batch N] [--lr X] [--lambda X] [--k X] SHARD...\n"
+         << "Fits the piece values and square bonuses to labeled positions (Texel tuning)\n"
+         << "and writes them as a header like src/EvalParams.hpp. Adam steps over\n"
+         << "minibatches by default; --gauss-newton takes one damped step per epoch.\n"
+         << "--lambda blends the game result (1, default) with the label score (0).\n";
+}
+
+int main(int argc, char **argv)
+{
+    string output;
+    vector<string> inputs;
+    int epochs = 10, threadCount = max(1u, thread::hardware_concurrency());
+    uint64_t maxPositions = 0;
+    size_t batch = 16384;
+    bool gaussNewton = false;
+    double learningRate = 1, k = 0;
+    float lambda = 1;
+
+    string command = "chess-tune";
+    for (int i = 1; i < argc; i++)
+        command += string(" ") + argv[i];
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--epochs" && i + 1 < argc)
+            epochs = atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else if (arg == "--max-positions" && i + 1 < argc)
+            maxPositions = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--batch" && i + 1 < argc)
+            batch = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--lr" && i + 1 < argc)
+            learningRate = atof(argv[++i]);
+        else if (arg == "--lambda" && i + 1 < argc)
+            lambda = float(atof(argv[++i]));
+        else if (arg == "--k" && i + 1 < argc)
+            k = atof(argv[++i]);
+        else if (arg == "--gauss-newton")
+            gaussNewton = true;
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else
+            inputs.push_back(arg);
+    }
+    if (output.empty() || inputs.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    // Load in shuffled order so consecutive minibatches are independent samples
+    auto start = chrono::steady_clock::now();
+    ShuffledReader reader;
+    if (!reader.open(inputs))
+    {
+        cerr << "Cannot read shards\n";
+        return 1;
+    }
+    vector<PackedPosition> positions;
+    positions.reserve(maxPositions ? min<uint64_t>(maxPositions, reader.size()) : reader.size());
+    PackedPosition packed;
+    while ((maxPositions == 0 || positions.size() < maxPositions) && reader.next(packed))
+        positions.push_back(packed);
+    TuningSet set;
+    set.load(positions);
+    positions = vector<PackedPosition>();
+    if (set.count == 0)
+    {
+        cerr << "No positions\n";
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Loaded " << set.count << " positions (" << set.slots << " slots, "
+         << set.features.size() * sizeof(uint16_t) / (1 << 20) << " MiB of features) in " << seconds << " s" << endl;
+
+    Weights weights = loadCurrentWeights();
+    if (k <= 0)
+    {
+        k = fitK(set, weights, threadCount, lambda);
+        cout << "Fitted K = " << k << endl;
+    }
+    set.setTargets(lambda, k);
+    Tuner tuner(set, threadCount, k);
+    cout << "Initial loss " << tuner.loss(weights) << endl;
+
+    // Adam state
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    vector<double> m(PARAM_COUNT), v(PARAM_COUNT);
+    uint64_t step = 0;
+    double damping = 1e-3;
+
+    for (int epoch = 1; epoch <= epochs; epoch++)
+    {
+        auto epochStart = chrono::steady_clock::now();
+        double epochLoss = 0;
+        if (gaussNewton)
+        {
+            // Levenberg-Marquardt: keep the step only if it lowered the loss
+            Weights before = weights;
+            epochLoss = tuner.gaussNewtonStep(weights, damping);
+            if (tuner.loss(weights) < epochLoss)
+                damping = max(1e-6, damping / 3);
+            else
+            {
+                weights = before;
+                damping *= 10;
+            }
+        }
+        else
+        {
+            for (size_t begin = 0; begin < set.count; begin += batch)
+            {
+                size_t end = min(set.count, begin + batch);
+                double batchLoss;
+                vector<double> g = tuner.gradient(weights, begin, end, batchLoss);
+                epochLoss += batchLoss * double(end - begin);
+                step++;
+                double correction1 = 1 - pow(beta1, double(step)), correction2 = 1 - pow(beta2, double(step));
+                for (int j = 0; j < PARAM_COUNT; j++)
+                {
+                    m[j] = beta1 * m[j] + (1 - beta1) * g[j];
+                    v[j] = beta2 * v[j] + (1 - beta2) * g[j] * g[j];
+                    weights.w[j] -= learningRate * (m[j] / correction1) / (sqrt(v[j] / correction2) + epsilon);
+                }
+            }
+            epochLoss /= double(set.count);
+        }
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - epochStart).count();
+        cout << "Epoch " << epoch << "  loss " << epochLoss << "  " << seconds << " s" << endl;
+
+        if (!writeHeader(output, weights, command))
+        {
+            cerr << "Cannot write " << output << "\n";
+            return 1;
+        }
+    }
+    if (epochs <= 0 && !writeHeader(output, weights, command))
+    {
+        cerr << "Cannot write " << output << "\n";
+        return 1;
+    }
+    cout << "Final loss " << tuner.loss(weights) << ", wrote " << output << endl;
+    return 0;
+}